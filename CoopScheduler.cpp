@@ -0,0 +1,116 @@
+/*
+ * CoopScheduler.cpp - Cooperative task scheduler for the time left between
+ *                     OLEDDisplayUiAux updates
+ */
+
+#include <Arduino.h>
+#include "CoopScheduler.h"
+
+
+int
+CoopScheduler::addTask(CoopTaskCallback callback, uint32_t period, uint8_t priority,
+                       uint16_t cost, uint32_t first_delay)
+{
+  CoopTask *t;
+
+  if (task_count >= COOP_TASK_MAX)
+    return -1;
+  t = &tasks[task_count];
+  t->callback = callback;
+  t->period = period;
+  t->priority = priority;
+  t->cost = cost;
+  t->due = millis() + first_delay;
+  t->armed = true;
+  return task_count++;
+}
+
+void
+CoopScheduler::schedule(int id, uint32_t delay)
+{
+  if (id < 0 || id >= task_count)
+    return;
+  tasks[id].due = millis() + delay;
+  tasks[id].armed = true;
+}
+
+void
+CoopScheduler::cancel(int id)
+{
+  if (id < 0 || id >= task_count)
+    return;
+  tasks[id].armed = false;
+}
+
+int
+CoopScheduler::pickTask(unsigned long now, long budget)
+  /* highest priority due task that fits or is too late, earlier due first */
+{
+  CoopTask *t;
+  long late;
+  int i, best = -1;
+
+  for (i = 0; i < task_count; i++) {
+    t = &tasks[i];
+    if (!t->armed || (late = (long)(now - t->due)) < 0)
+      continue;
+    if (t->cost > budget && late < COOP_TASK_MAX_LATE)
+      continue;
+    if (best < 0 || t->priority > tasks[best].priority ||
+        (t->priority == tasks[best].priority && (long)(t->due - tasks[best].due) < 0))
+      best = i;
+  }
+  return best;
+}
+
+long
+CoopScheduler::run(long budget)
+{
+  unsigned long start = millis(), now, took;
+  CoopTask *t;
+  int i;
+
+  for (;;) {
+    now = millis();
+    if ((i = pickTask(now, budget - (long)(now - start))) < 0)
+      break;
+    t = &tasks[i];
+    /* rearm before run so that the task can reschedule itself */
+    if (t->period)
+      t->due = now + t->period;
+    else
+      t->armed = false;
+
+    t->callback();
+
+    /* follow longer run at once, shorter slowly */
+    took = millis() - now;
+    if (took > t->cost)
+      t->cost = (took > 0xffff)? 0xffff : took;
+    else
+      t->cost = (t->cost * 7 + took) / 8;
+  }
+  return budget - (long)(millis() - start);
+}
+
+long
+CoopScheduler::getNextDue(long budget)
+  /* as pickTask() would: a task not fitting in budget waits to be forced */
+{
+  unsigned long now = millis();
+  long next = -1, d;
+  int i;
+
+  for (i = 0; i < task_count; i++) {
+    if (!tasks[i].armed)
+      continue;
+    d = (long)(tasks[i].due - now);
+    if (tasks[i].cost > budget)
+      d += COOP_TASK_MAX_LATE;
+    if (d < 0)
+      d = 0;
+    if (next < 0 || d < next)
+      next = d;
+  }
+  return next;
+}
@@ -0,0 +1,62 @@
+/*
+ * CoopScheduler.h - Cooperative task scheduler for the time left between
+ *                   OLEDDisplayUiAux updates
+ *
+ * Tasks are plain functions run to completion from loop(). run() is given
+ * the time budget until the next ui update and only starts due tasks whose
+ * estimated cost fits in what is left, highest priority first. Costs start
+ * from the given estimate and follow measured run times. A task that could
+ * not fit for COOP_TASK_MAX_LATE ms runs anyway not to starve.
+ */
+
+#ifndef __COOP_SCHEDULER_H__
+#define __COOP_SCHEDULER_H__
+
+#include <Arduino.h>
+
+#define COOP_TASK_MAX       8
+#define COOP_TASK_MAX_LATE  30000   /* ms */
+
+typedef void (*CoopTaskCallback)(void);
+
+struct CoopTask {
+  CoopTaskCallback callback;
+  uint32_t period;          /* ms; 0 for one-shot */
+  unsigned long due;        /* millis() to run at */
+  uint16_t cost;            /* estimated run time in ms */
+  uint8_t priority;         /* larger runs first */
+  bool armed;
+};
+
+class CoopScheduler {
+private:
+  CoopTask tasks[COOP_TASK_MAX];
+  uint8_t task_count;
+
+  int pickTask(unsigned long now, long budget);
+
+public:
+  CoopScheduler() {
+    task_count = 0;
+  }
+
+  /* add task to run after first_delay ms, then every period ms if not 0;
+     returns task id, or -1 if full */
+  int addTask(CoopTaskCallback callback, uint32_t period, uint8_t priority,
+              uint16_t cost, uint32_t first_delay = 0);
+  /* (re)arm task to run after delay ms */
+  void schedule(int id, uint32_t delay);
+  void cancel(int id);
+  uint16_t getCost(int id) {
+    return (id >= 0 && id < task_count)? tasks[id].cost : 0;
+  }
+
+  /* run due tasks fitting in budget ms; returns budget left */
+  long run(long budget);
+  /* ms until the next task runs with budget ms for it, 0 if now, -1 if
+     none is armed; one not fitting in budget counts when forced, so a
+     tight budget does not keep loop() from sleeping */
+  long getNextDue(long budget);
+};
+
+#endif  /* __COOP_SCHEDULER_H__ */
@@ -0,0 +1,131 @@
+/*
+ * IdleManager.cpp - Sleep from the end of loop() work to the next deadline
+ */
+
+#include <Arduino.h>
+#include "IdleManager.h"
+
+/* upper bounds of histogram buckets but the last, ms */
+static const uint16_t HISTOGRAM_BOUNDS[IDLE_HISTOGRAM - 1] = {
+  IDLE_MIN_SLEEP, 20, 50, 200, 1000
+};
+
+
+bool
+IdleManager::addDeadline(IdleDeadlineFunction deadline_function)
+{
+  if (deadline_count >= IDLE_SOURCE_MAX)
+    return false;
+  deadlines[deadline_count++] = deadline_function;
+  return true;
+}
+
+bool
+IdleManager::addWake(IdleWakeFunction wake_function)
+{
+  if (wake_count >= IDLE_SOURCE_MAX)
+    return false;
+  wakes[wake_count++] = wake_function;
+  return true;
+}
+
+bool
+IdleManager::pendingWake(void)
+  /* all sources are asked, so each can schedule its reader */
+{
+  bool pending = false;
+  uint8_t i;
+
+  for (i = 0; i < wake_count; i++)
+    if ((wakes[i])())
+      pending = true;
+  return pending;
+}
+
+long
+IdleManager::getTimeToDeadline(long budget)
+{
+  long t;
+  uint8_t i;
+
+  for (i = 0; i < deadline_count && budget > 0; i++) {
+    t = (deadlines[i])();
+    if (t >= 0 && t < budget)
+      budget = t;
+  }
+  return (budget > 0)? budget : 0;
+}
+
+unsigned long
+IdleManager::wait(long budget)
+{
+  unsigned long start = millis(), end, before, waited;
+  long t, left;
+  bool slept = false, woke = false;
+  uint8_t i;
+
+  t = getTimeToDeadline(budget);
+  if (t <= 0)
+    return 0;
+  if (pendingWake()) {
+    wake_count_early++;
+    return 0;
+  }
+
+  end = start + t;
+  if (t >= IDLE_MIN_SLEEP && sleep_function != NULL) {
+    for (;;) {
+      left = (long)(end - millis()) - IDLE_WAKE_AHEAD;
+      if (left <= 0)
+        break;
+      before = millis();
+      (sleep_function)((left < max_slice)? left : max_slice);
+      slept_ms += millis() - before;
+      slept = true;
+      if (pendingWake()) {
+        woke = true;
+        break;
+      }
+    }
+  }
+  /* rest of the wait, and the wake ahead margin, awake */
+  if (!woke && (left = (long)(end - millis())) > 0)
+    delay(left);
+
+  waited = millis() - start;
+  idle_ms += waited;
+  if (slept)
+    sleep_count++;
+  if (woke)
+    wake_count_early++;
+  for (i = 0; i < IDLE_HISTOGRAM - 1 && waited >= HISTOGRAM_BOUNDS[i]; i++)
+    ;
+  histogram[i]++;
+  return waited;
+}
+
+void
+IdleManager::resetStats(void)
+{
+  stat_start = millis();
+  idle_ms = 0;
+  slept_ms = 0;
+  sleep_count = 0;
+  wake_count_early = 0;
+  memset(histogram, 0, sizeof(histogram));
+}
+
+void
+IdleManager::printStats(Print *out)
+{
+  uint32_t elapsed = getElapsedMs();
+  uint8_t i;
+
+  out->printf("idle %u of %u ms (%u%%), slept %u ms in %u sleeps, %u woken by data\n",
+              idle_ms, elapsed, elapsed? (unsigned)((uint64_t)idle_ms * 100 / elapsed) : 0,
+              slept_ms, sleep_count, wake_count_early);
+  out->printf("idle intervals:");
+  for (i = 0; i < IDLE_HISTOGRAM - 1; i++)
+    out->printf(" <%u ms %u,", HISTOGRAM_BOUNDS[i], histogram[i]);
+  out->printf(" longer %u\n", histogram[IDLE_HISTOGRAM - 1]);
+}
@@ -0,0 +1,100 @@
+/*
+ * IdleManager.h - Sleep from the end of loop() work to the next deadline
+ *
+ * Deadline sources tell in how many ms they need loop() again: the ui
+ * update, scheduled tasks with the sensor polls, LED animation frames.
+ * wait() takes the earliest of them and sleeps until then through the
+ * platform sleep function, ie. delay() with WiFi light sleep on the
+ * ESP8266, waking IDLE_WAKE_AHEAD ms early not to miss display timing.
+ *
+ * Sleep goes in slices of at most max_slice ms. Before each slice, wake
+ * sources are checked for pending data, ie. UART bytes or an MQTT
+ * packet; one with data ends the wait and typically schedules the task
+ * reading it. Waits shorter than IDLE_MIN_SLEEP are plain delay().
+ *
+ * Idle intervals are counted whether slept or not, so the duty cycle
+ * saved can be told on a host run as well.
+ */
+
+#ifndef __IDLE_MANAGER_H__
+#define __IDLE_MANAGER_H__
+
+#include <Arduino.h>
+
+#define IDLE_SOURCE_MAX     6
+#define IDLE_MIN_SLEEP      5     /* ms */
+#define IDLE_WAKE_AHEAD     2     /* ms woken before the deadline */
+#define IDLE_HISTOGRAM      6     /* buckets of idle interval lengths */
+
+/* ms until the source is due, 0 if due now, -1 if nothing is pending */
+typedef long (*IdleDeadlineFunction)(void);
+/* true if data is waiting, so the wait should end */
+typedef bool (*IdleWakeFunction)(void);
+/* sleep up to ms */
+typedef void (*IdleSleepFunction)(unsigned long ms);
+
+class IdleManager {
+private:
+  IdleDeadlineFunction deadlines[IDLE_SOURCE_MAX];
+  uint8_t deadline_count;
+  IdleWakeFunction wakes[IDLE_SOURCE_MAX];
+  uint8_t wake_count;
+  IdleSleepFunction sleep_function;
+  uint16_t max_slice;
+
+  unsigned long stat_start;
+  uint32_t idle_ms;           /* in wait(), slept or delayed */
+  uint32_t slept_ms;          /* in the sleep function */
+  uint32_t sleep_count;
+  uint32_t wake_count_early;  /* waits ended by a wake source */
+  uint32_t histogram[IDLE_HISTOGRAM];
+
+  bool pendingWake(void);
+
+public:
+  IdleManager(IdleSleepFunction _sleep_function = NULL, uint16_t _max_slice = 100) {
+    deadline_count = 0;
+    wake_count = 0;
+    sleep_function = _sleep_function;
+    max_slice = _max_slice? _max_slice : 1;
+    resetStats();
+  }
+
+  /* returns false if sources are full */
+  bool addDeadline(IdleDeadlineFunction deadline_function);
+  bool addWake(IdleWakeFunction wake_function);
+  void setSleepFunction(IdleSleepFunction _sleep_function, uint16_t _max_slice = 100) {
+    sleep_function = _sleep_function;
+    max_slice = _max_slice? _max_slice : 1;
+  }
+
+  /* ms to the earliest deadline, at most budget */
+  long getTimeToDeadline(long budget);
+  /* wait up to budget ms, until a deadline or data; returns ms waited */
+  unsigned long wait(long budget);
+
+  /* statistics from the last reset; histogram buckets are idle
+     intervals of <IDLE_MIN_SLEEP, <20, <50, <200, <1000 and longer */
+  void resetStats(void);
+  uint32_t getElapsedMs(void) {
+    return millis() - stat_start;
+  }
+  uint32_t getIdleMs(void) {
+    return idle_ms;
+  }
+  uint32_t getSleptMs(void) {
+    return slept_ms;
+  }
+  uint32_t getSleepCount(void) {
+    return sleep_count;
+  }
+  uint32_t getWakeCount(void) {
+    return wake_count_early;
+  }
+  const uint32_t *getHistogram(void) {
+    return histogram;
+  }
+  void printStats(Print *out);
+};
+
+#endif  /* __IDLE_MANAGER_H__ */
@@ -0,0 +1,286 @@
+/*
+ * LedCompositor.cpp - Desired state of a small LED strip, shown only when changed
+ */
+
+#include <Arduino.h>
+#include "LedCompositor.h"
+
+/* PWM of perceptual level i in 8.8 fixed point: 255 * (i / 255)^2.2 */
+static const uint16_t GAMMA_8_8[256] PROGMEM = {
+      0,     0,     2,     4,     7,    11,    17,    24,    32,    42,    53,    65,
+     78,    94,   110,   128,   148,   169,   191,   216,   241,   269,   298,   328,
+    360,   394,   430,   467,   506,   547,   589,   633,   679,   726,   776,   827,
+    880,   934,   991,  1049,  1109,  1171,  1235,  1300,  1368,  1437,  1508,  1581,
+   1656,  1733,  1812,  1893,  1975,  2060,  2146,  2235,  2325,  2417,  2512,  2608,
+   2706,  2806,  2908,  3013,  3119,  3227,  3337,  3450,  3564,  3680,  3798,  3919,
+   4041,  4166,  4292,  4421,  4552,  4685,  4819,  4956,  5096,  5237,  5380,  5525,
+   5673,  5823,  5974,  6128,  6284,  6442,  6603,  6765,  6930,  7097,  7266,  7437,
+   7610,  7786,  7963,  8143,  8325,  8509,  8696,  8885,  9075,  9268,  9464,  9661,
+   9861, 10063, 10267, 10474, 10682, 10893, 11107, 11322, 11540, 11760, 11982, 12207,
+  12433, 12663, 12894, 13128, 13363, 13602, 13842, 14085, 14330, 14578, 14827, 15080,
+  15334, 15591, 15850, 16111, 16375, 16641, 16909, 17180, 17453, 17729, 18006, 18287,
+  18569, 18854, 19141, 19431, 19723, 20017, 20314, 20613, 20915, 21218, 21525, 21833,
+  22144, 22458, 22774, 23092, 23413, 23736, 24062, 24390, 24720, 25053, 25388, 25726,
+  26066, 26408, 26753, 27101, 27451, 27803, 28158, 28515, 28875, 29237, 29602, 29969,
+  30338, 30710, 31085, 31462, 31841, 32223, 32608, 32995, 33384, 33776, 34170, 34567,
+  34967, 35369, 35773, 36180, 36589, 37001, 37416, 37833, 38252, 38674, 39099, 39526,
+  39956, 40388, 40823, 41260, 41700, 42142, 42587, 43034, 43484, 43937, 44392, 44849,
+  45310, 45772, 46238, 46706, 47176, 47649, 48125, 48603, 49084, 49567, 50053, 50542,
+  51033, 51526, 52023, 52522, 53023, 53527, 54034, 54543, 55055, 55570, 56087, 56607,
+  57129, 57654, 58182, 58712, 59245, 59780, 60318, 60859, 61402, 61948, 62497, 63048,
+  63602, 64159, 64718, 65280,
+};
+
+/* breathe level over a period at 64 points: 255 * (1 - cos(2 pi t)) / 2 */
+static const uint8_t BREATHE[65] PROGMEM = {
+    0,   1,   2,   5,  10,  15,  21,  29,  37,  47,  57,  67,  79,
+   90, 103, 115, 127, 140, 152, 165, 176, 188, 198, 208, 218, 226,
+  234, 240, 245, 250, 253, 254, 255, 254, 253, 250, 245, 240, 234,
+  226, 218, 208, 198, 188, 176, 165, 152, 140, 128, 115, 103,  90,
+   79,  67,  57,  47,  37,  29,  21,  15,  10,   5,   2,   1,   0,
+};
+
+
+static bool
+same_color(LedColor a, LedColor b)
+{
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static LedColor
+scale_color(LedColor c, uint8_t level)
+  /* perceptual scale by level / 255 */
+{
+  c.r = (uint16_t)c.r * level / 255;
+  c.g = (uint16_t)c.g * level / 255;
+  c.b = (uint16_t)c.b * level / 255;
+  return c;
+}
+
+void
+LedCompositor::setEffect(uint8_t _effect, uint8_t _mask)
+{
+  if (effect != _effect || mask != _mask) {
+    effect = _effect;
+    mask = _mask;
+    restart = true;
+  }
+  if (restart)
+    dirty = true;
+}
+
+void
+LedCompositor::setPixel(uint8_t i, LedColor c)
+{
+  if (i >= count || (same_color(pixels[i], c) && !(mask & (1 << i))))
+    return;
+  pixels[i] = c;
+  mask &= ~(1 << i);
+  dirty = true;
+}
+
+void
+LedCompositor::fill(LedColor c)
+{
+  uint8_t i;
+
+  for (i = 0; i < count; i++) {
+    if (!same_color(pixels[i], c))
+      dirty = true;
+    pixels[i] = c;
+  }
+  if (effect != LED_EFFECT_NONE)
+    dirty = true;
+  effect = LED_EFFECT_NONE;
+  mask = 0;
+}
+
+void
+LedCompositor::breathe(LedColor c, uint16_t period_ms, uint8_t _mask)
+{
+  if (effect != LED_EFFECT_BREATHE || !same_color(color, c) || period != period_ms)
+    restart = true;
+  color = c;
+  period = period_ms? period_ms : 1;
+  setEffect(LED_EFFECT_BREATHE, _mask);
+}
+
+void
+LedCompositor::progress(int32_t cur, int32_t max, LedColor c, uint16_t speed)
+{
+  if (max <= 0)
+    max = 1;
+  if (cur < 0) cur = 0;
+  if (cur > max) cur = max;
+  if (effect != LED_EFFECT_PROGRESS)
+    progress_pos = 0;   /* sweep from start */
+  cur = (int64_t)cur * count * 256 / max;
+  if (cur != progress_target) {
+    if (progress_pos == progress_target)
+      restart = true;   /* settled; move from the next update on */
+    dirty = true;
+  }
+  if (!same_color(color, c))
+    dirty = true;
+  progress_target = cur;
+  progress_speed = speed;
+  color = c;
+  setEffect(LED_EFFECT_PROGRESS, 0xff);
+}
+
+void
+LedCompositor::gradient(int16_t value, int16_t step, const LedGradientStop *_stops, uint8_t _stop_count,
+                        uint8_t level)
+{
+  if (step <= 0)
+    step = 1;
+  if (gradient_value != value || gradient_step != step || stops != _stops ||
+      stop_count != _stop_count || gradient_level != level)
+    dirty = true;
+  gradient_value = value;
+  gradient_step = step;
+  stops = _stops;
+  stop_count = _stop_count;
+  gradient_level = level;
+  setEffect(LED_EFFECT_GRADIENT, 0xff);
+}
+
+void
+LedCompositor::gradientColor(int16_t value, LedColor *c)
+  /* color of value interpolated between PROGMEM stops, clamped at ends */
+{
+  LedGradientStop s0, s1;
+  int32_t t;
+  uint8_t i;
+
+  memset(c, 0, sizeof(*c));
+  if (stops == NULL || stop_count == 0)
+    return;
+  memcpy_P(&s0, &stops[0], sizeof(s0));
+  if (value <= s0.value) {
+    *c = s0.color;
+    return;
+  }
+  for (i = 1; i < stop_count; i++) {
+    memcpy_P(&s1, &stops[i], sizeof(s1));
+    if (value < s1.value) {
+      /* 8 bit fraction between stops */
+      t = (int32_t)(value - s0.value) * 256 / (s1.value - s0.value);
+      c->r = s0.color.r + (((int32_t)s1.color.r - s0.color.r) * t >> 8);
+      c->g = s0.color.g + (((int32_t)s1.color.g - s0.color.g) * t >> 8);
+      c->b = s0.color.b + (((int32_t)s1.color.b - s0.color.b) * t >> 8);
+      return;
+    }
+    s0 = s1;
+  }
+  *c = s0.color;
+}
+
+bool
+LedCompositor::update(unsigned long now)
+{
+  LedColor out[LED_MAX], p, gc;
+  uint32_t phase, frac, v;
+  int32_t step, lit;
+  uint8_t level, i, k, a, b;
+  uint8_t *ch;
+  bool changed;
+
+  if (!dirty && shown_valid && (!animating || (long)(now - next_update) < 0))
+    return false;
+
+  if (restart) {
+    start = now;
+    last_update = now;
+    restart = false;
+  }
+
+  /* effect state at now */
+  level = 0;
+  if (effect == LED_EFFECT_BREATHE) {
+    /* Q16 phase, 10 bit fraction between table points */
+    phase = (uint32_t)((now - start) % period) * 65536 / period;
+    a = pgm_read_byte(&BREATHE[phase >> 10]);
+    b = pgm_read_byte(&BREATHE[(phase >> 10) + 1]);
+    level = a + (((int32_t)b - a) * (int32_t)(phase & 1023) >> 10);
+  }
+  else if (effect == LED_EFFECT_PROGRESS && progress_pos != progress_target) {
+    step = (int32_t)((now - last_update) * progress_speed * 256 / 1000);
+    if (progress_pos < progress_target)
+      progress_pos = (progress_pos + step < progress_target)? progress_pos + step : progress_target;
+    else
+      progress_pos = (progress_pos - step > progress_target)? progress_pos - step : progress_target;
+  }
+  else if (effect == LED_EFFECT_GRADIENT) {
+    gradientColor(gradient_value, &gc);
+    gc = scale_color(gc, gradient_level);
+  }
+  animating = effect == LED_EFFECT_BREATHE ||
+              (effect == LED_EFFECT_PROGRESS && progress_pos != progress_target);
+
+  for (i = 0; i < count; i++) {
+    p = pixels[i];
+    frac = 256;   /* linear scale of pixel */
+    if (mask & (1 << i)) {
+      switch (effect) {
+      case LED_EFFECT_BREATHE:
+        p = scale_color(color, level);
+        break;
+      case LED_EFFECT_PROGRESS:
+        p = color;
+        lit = progress_pos - (int32_t)i * 256;
+        frac = (lit <= 0)? 0 : (lit >= 256)? 256 : lit;
+        break;
+      case LED_EFFECT_GRADIENT:
+        if (gradient_value >= (int32_t)i * gradient_step)
+          p = gc;
+        else
+          memset(&p, 0, sizeof(p));
+        break;
+      }
+    }
+
+    /* gamma to 8.8 PWM, then dither while animated or round */
+    for (k = 0; k < 3; k++) {
+      ch = (k == 0)? &p.r : (k == 1)? &p.g : &p.b;
+      v = (uint32_t)pgm_read_word(&GAMMA_8_8[*ch]) * frac >> 8;
+      if (animating && (mask & (1 << i))) {
+        v += residual[i][k];
+        residual[i][k] = v & 0xff;
+        v >>= 8;
+      }
+      else {
+        residual[i][k] = 0;
+        v = (v + 128) >> 8;
+      }
+      if (k == 0) out[i].r = (v > 255)? 255 : v;
+      else if (k == 1) out[i].g = (v > 255)? 255 : v;
+      else out[i].b = (v > 255)? 255 : v;
+    }
+  }
+
+  dirty = false;
+  last_update = now;
+  next_update = now + LED_FRAME_INTERVAL;
+
+  changed = !shown_valid;
+  for (i = 0; i < count && !changed; i++)
+    changed = !same_color(out[i], shown[i]);
+  if (!changed)
+    return false;
+  memcpy(shown, out, sizeof(LedColor) * count);
+  shown_valid = true;
+  show_count++;
+  (show)(shown, count);
+  return true;
+}
+
+long
+LedCompositor::getTimeToUpdate(unsigned long now)
+{
+  if (dirty || !shown_valid)
+    return 0;
+  if (!animating)
+    return -1;
+  return ((long)(next_update - now) > 0)? (long)(next_update - now) : 0;
+}
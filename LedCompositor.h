@@ -0,0 +1,137 @@
+/*
+ * LedCompositor.h - Desired state of a small LED strip, shown only when changed
+ *
+ * Pixels are set in perceptual 0~255 levels and mapped to PWM through a
+ * gamma table in 8.8 fixed point. An effect may run over masked pixels:
+ * breathe, progress sweep, or a color gradient by value such as AQI.
+ * update() renders the state at a time given by the caller, the same
+ * millis() the ui runs on, and calls the show function only when the
+ * PWM values differ from what the strip shows.
+ *
+ * While an effect animates, the 8.8 values are dithered in time so that
+ * slow fades at low brightness step below one PWM level; static states
+ * are rounded, so they settle and are not pushed again.
+ */
+
+#ifndef __LED_COMPOSITOR_H__
+#define __LED_COMPOSITOR_H__
+
+#include <Arduino.h>
+
+#define LED_MAX             8     /* pixels */
+#define LED_FRAME_INTERVAL  33    /* ms between animation frames */
+
+struct LedColor {
+  uint8_t r, g, b;
+};
+
+/* Gradient stop: color at value, interpolated in between */
+struct LedGradientStop {
+  int16_t value;
+  LedColor color;
+};
+
+typedef void (*LedShowFunction)(const LedColor *pixels, uint8_t count);
+
+enum LedEffect {
+  LED_EFFECT_NONE,
+  LED_EFFECT_BREATHE,
+  LED_EFFECT_PROGRESS,
+  LED_EFFECT_GRADIENT
+};
+
+class LedCompositor {
+private:
+  LedShowFunction show;
+  uint8_t count;
+
+  LedColor pixels[LED_MAX];     /* static colors, perceptual */
+  uint8_t effect;
+  uint8_t mask;                 /* pixels under effect */
+  LedColor color;               /* breathe and progress color */
+  uint16_t period;              /* breathe period ms */
+  unsigned long start;          /* effect start millis() */
+
+  int32_t progress_target;      /* lit length in 1/256 pixel */
+  int32_t progress_pos;
+  uint16_t progress_speed;      /* pixels per second */
+
+  const LedGradientStop *stops; /* PROGMEM */
+  uint8_t stop_count;
+  int16_t gradient_value;
+  int16_t gradient_step;        /* value per lit pixel */
+  uint8_t gradient_level;       /* perceptual scale of stop colors */
+
+  uint8_t residual[LED_MAX][3]; /* dither error, 1/256 PWM */
+  LedColor shown[LED_MAX];
+  bool shown_valid;
+  bool dirty;                   /* state set since the last update */
+  bool restart;                 /* effect to start at the next update */
+  unsigned long last_update;
+  unsigned long next_update;
+  bool animating;
+  uint32_t show_count;
+
+  void setEffect(uint8_t _effect, uint8_t _mask);
+  void gradientColor(int16_t value, LedColor *c);
+
+public:
+  LedCompositor(LedShowFunction _show, uint8_t _count) {
+    show = _show;
+    count = (_count < LED_MAX)? _count : LED_MAX;
+    memset(pixels, 0, sizeof(pixels));
+    effect = LED_EFFECT_NONE;
+    mask = 0;
+    memset(&color, 0, sizeof(color));
+    period = 1;
+    start = 0;
+    progress_pos = 0;
+    progress_target = 0;
+    progress_speed = 0;
+    stops = NULL;
+    stop_count = 0;
+    gradient_value = 0;
+    gradient_step = 1;
+    gradient_level = 0;
+    memset(residual, 0, sizeof(residual));
+    shown_valid = false;
+    dirty = true;
+    restart = false;
+    last_update = 0;
+    next_update = 0;
+    animating = false;
+    show_count = 0;
+  }
+
+  /* static colors; effect stops on the pixels set */
+  void setPixel(uint8_t i, LedColor c);
+  void fill(LedColor c);
+
+  /* Effects keep running when set again the same, so they can be set
+     on each frame draw */
+
+  /* pixels in mask fade in and out of c over period ms */
+  void breathe(LedColor c, uint16_t period_ms, uint8_t _mask = 0xff);
+  /* light cur / max of the strip in c, the edge moving there at
+     speed pixels per second with a fractional lead pixel */
+  void progress(int32_t cur, int32_t max, LedColor c, uint16_t speed = 8);
+  /* light a pixel per step of value, from 0, in the gradient color of
+     value scaled by level; stops in PROGMEM sorted by value */
+  void gradient(int16_t value, int16_t step, const LedGradientStop *_stops, uint8_t _stop_count,
+                uint8_t level = 255);
+
+  /* render state at now and show it if changed; returns true if shown */
+  bool update(unsigned long now);
+  /* ms to the next animation frame, -1 if the state is static */
+  long getTimeToUpdate(unsigned long now);
+
+  /* strip content unknown, ie. after showing something else */
+  void invalidate(void) {
+    shown_valid = false;
+  }
+  uint32_t getShowCount(void) {
+    return show_count;
+  }
+};
+
+#endif  /* __LED_COMPOSITOR_H__ */
@@ -21,23 +21,75 @@
 
 #include "NTPClient.h"
 
+// NTP timestamp at p, seconds since 1900 and 32 bit fraction, to ms since 1970
+static uint64_t ntpToEpochMillis(const byte *p) {
+  uint32_t secs = (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3];
+  uint32_t frac = (uint32_t) p[4] << 24 | (uint32_t) p[5] << 16 | (uint32_t) p[6] << 8 | p[7];
+  // era 1 from 2036 on, as seconds of era 0 are at least 2^31 since 1968
+  uint64_t secs1900 = secs & 0x80000000UL ? (uint64_t) secs : (uint64_t) secs + 0x100000000ULL;
+  return (secs1900 - SEVENZYYEARS) * 1000 + (((uint64_t) frac * 1000) >> 32);
+}
+
+static const char* const weekdaysEnglish[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+// Year, month 1-12 and day 1-31 of days since 1970-01-01, proleptic Gregorian
+static void civilFromDays(long days, int *year, int *month, int *day) {
+  days += 719468;  // from 0000-03-01, so that leap days end the year
+  long era = (days >= 0 ? days : days - 146096) / 146097;
+  unsigned long doe = days - era * 146097;                                // [0, 146096]
+  unsigned long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+  unsigned long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);            // [0, 365]
+  unsigned long mp = (5 * doy + 2) / 153;                                 // [0, 11] from March
+  *day = doy - (153 * mp + 2) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year = yoe + era * 400 + (*month <= 2);
+}
+
+static const uint16_t daysBeforeMonth[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+static char* appendNumber(char *p, unsigned int n) {
+  char digits[10];
+  int i = 0;
+  do {
+    digits[i++] = '0' + n % 10;
+    n /= 10;
+  } while (n);
+  while (i)
+    *p++ = digits[--i];
+  return p;
+}
+
+static void epochMillisToNtp(uint64_t ms, byte *p) {
+  uint32_t secs = (uint32_t) (ms / 1000 + SEVENZYYEARS);
+  uint32_t frac = (uint32_t) (((ms % 1000) << 32) / 1000);
+  for (int i = 0; i < 4; i++) {
+    p[i] = secs >> (24 - i * 8);
+    p[4 + i] = frac >> (24 - i * 8);
+  }
+}
+
 NTPClient::NTPClient(int timeOffset) {
   this->_timeOffset     = timeOffset;
+  this->_weekdays       = weekdaysEnglish;
 }
 
 NTPClient::NTPClient(const char* poolServerName) {
   this->_poolServerName = poolServerName;
+  this->_weekdays       = weekdaysEnglish;
 }
 
 NTPClient::NTPClient(const char* poolServerName, int timeOffset) {
   this->_timeOffset     = timeOffset;
   this->_poolServerName = poolServerName;
+  this->_weekdays       = weekdaysEnglish;
 }
 
 NTPClient::NTPClient(const char* poolServerName, int timeOffset, int updateInterval) {
   this->_timeOffset     = timeOffset;
+  this->_weekdays       = weekdaysEnglish;
   this->_poolServerName = poolServerName;
   this->_updateInterval = updateInterval;
+  this->_pollInterval   = updateInterval;
 }
 
 void NTPClient::begin() {
@@ -51,49 +103,445 @@ void NTPClient::begin() {
 }
 
 void NTPClient::forceUpdate() {
-  #ifdef DEBUG_NTPClient
-    Serial.println("Update from NTP Server");
-  #endif
+  if (this->_state == NTP_WAITING)
+    return;  // a reply is on its way
+  this->_requestDue = true;
+  this->_nextRequest = millis();
+}
 
+bool NTPClient::update() {
+  unsigned long now = millis();
+  uint64_t mono = this->getMonotonicMillis();
+
+  this->pollLookup();  // answered since the last call
+
+  if (this->_state == NTP_IDLE) {
+    if (!this->_requestDue || (long) (now - this->_nextRequest) < 0) {
+      // Look addresses up between requests, off the path of the next one
+      if (!this->_requestDue || (long) (this->_nextRequest - now) > NTP_DNS_LEAD)
+        this->refreshServers(false);
+      return false;
+    }
+
+    #ifdef DEBUG_NTPClient
+      Serial.println("Update from NTP Server");
+    #endif
+    // drop a late reply to an earlier request; parsePacket() moves past it
+    while (this->_udp.parsePacket() > 0)
+      ;
+    if (this->_serverCount == 0 && !this->_lookupWaited) {
+      // nothing cached yet: the request goes with the address, or fails
+      this->_lookupWaited = true;
+      this->refreshServers(true);
+    }
+    if (this->_serverCount == 0 && this->_lookupState == NTP_LOOKUP_PENDING)
+      return false;
+    this->_lookupWaited = false;
+    if (!this->sendRound()) {
+      this->complete(false);
+      return false;
+    }
+    this->_state = NTP_WAITING;
+    return false;
+  }
+
+  // NTP_WAITING: take the replies there, from all servers of the round
+  int cb;
+  while ((cb = this->_udp.parsePacket()) > 0) {
+    // a short packet is not a reply and is skipped by the next parsePacket()
+    if (cb >= NTP_PACKET_SIZE)
+      this->takeReply(mono);
+  }
+  if (this->_pendingCount > 0 && now - this->_requestedAt < this->_timeout)
+    return false;
+  return this->finishRound();
+}
+
+void NTPClient::refreshServers(bool force) {
+  unsigned long now = millis();
+
+  if (this->_lookupState != NTP_LOOKUP_IDLE)
+    return;  // one at a time
+  // forced when nothing is cached, unless backing off after a failure
+  if ((!force || this->_lookupBackoff > NTP_DNS_INTERVAL) && this->_lookedUp &&
+      (long) (now - this->_nextLookup) < 0)
+    return;
+  this->_lookedUp = true;
+  this->_nextLookup = now + NTP_DNS_INTERVAL;
+  this->startLookup();
+  this->pollLookup();  // answered at once, ie. from the resolver cache
+}
+
+void NTPClient::startLookup() {
+  this->_lookupStarted = millis();
+  this->_lookupState = NTP_LOOKUP_PENDING;
+#ifdef ESP8266
+  // Not WiFi.hostByName(), which waits for the resolver in loop()
+  ip_addr_t address;
+  err_t err = dns_gethostbyname(this->_poolServerName, &address, &NTPClient::lookupFound, this);
+  if (err == ERR_INPROGRESS)
+    return;  // lookupFound() gets the answer
+  #if LWIP_VERSION_MAJOR == 1
+    this->_lookupAddress = err == ERR_OK ? address.addr : 0;
+  #else
+    this->_lookupAddress = err == ERR_OK ? ip4_addr_get_u32(ip_2_ip4(&address)) : 0;
+  #endif
+#else
+  // No asynchronous resolver here: blocks, paced by the lookup backoff
   IPAddress address;
-  WiFi.hostByName(this->_poolServerName, address);
+  this->_lookupAddress = WiFi.hostByName(this->_poolServerName, address) ? (uint32_t) address : 0;
+#endif
+  this->_lookupState = NTP_LOOKUP_DONE;
+}
 
-  this->sendNTPPacket(address);
+#ifdef ESP8266
+#if LWIP_VERSION_MAJOR == 1
+void NTPClient::lookupFound(const char* name, ip_addr_t* ipaddr, void* arg) {
+#else
+void NTPClient::lookupFound(const char* name, const ip_addr_t* ipaddr, void* arg) {
+#endif
+  NTPClient* client = (NTPClient*) arg;
 
-  // Wait till data is there or timeout...
-  byte timeout = 0;
-  int cb = 0;
-  do {
-    delay ( 10 );
-    cb = this->_udp.parsePacket();
-    if (timeout > 100) return; // timeout after 1000 ms
-    timeout++;
-  } while (cb == 0);
+  // Resolver context: only hand the answer over to update()
+  if (client->_lookupState != NTP_LOOKUP_PENDING)
+    return;  // given up on
+  #if LWIP_VERSION_MAJOR == 1
+    client->_lookupAddress = ipaddr ? ipaddr->addr : 0;
+  #else
+    client->_lookupAddress = ipaddr ? ip4_addr_get_u32(ip_2_ip4(ipaddr)) : 0;
+  #endif
+  client->_lookupState = NTP_LOOKUP_DONE;
+}
+#endif
+
+void NTPClient::pollLookup() {
+  if (this->_lookupState == NTP_LOOKUP_PENDING &&
+      millis() - this->_lookupStarted >= NTP_DNS_TIMEOUT) {
+    this->_lookupAddress = 0;
+    this->_lookupState = NTP_LOOKUP_DONE;
+  }
+  if (this->_lookupState != NTP_LOOKUP_DONE)
+    return;
+  this->_lookupState = NTP_LOOKUP_IDLE;
+  this->takeAddress(IPAddress((uint32_t) this->_lookupAddress));
+}
+
+void NTPClient::takeAddress(IPAddress address) {
+  unsigned long now = millis();
+  uint8_t i, stale = NTP_SERVERS_MAX;
 
-  this->_lastUpdate = millis() - (10 * (timeout + 1)); // Account for delay in reading the time
+  if ((uint32_t) address == 0) {
+    // Resolver unreachable or name not found: back off, the cache is
+    // kept and used meanwhile
+    this->_nextLookup = now + this->_lookupBackoff;
+    this->_lookupBackoff = this->_lookupBackoff * 2 < NTP_DNS_TTL ? this->_lookupBackoff * 2 : NTP_DNS_TTL;
+    return;
+  }
+  this->_lookupBackoff = NTP_DNS_INTERVAL;
+
+  // A pool name resolves to another address now and then; successive
+  // lookups fill the cache, known ones get their time renewed
+  for (i = 0; i < this->_serverCount; i++) {
+    if (this->_servers[i].address == address)
+      break;
+    if ((long) (now - this->_servers[i].expires) >= 0)
+      stale = i;
+  }
+  if (i == this->_serverCount) {
+    if (this->_serverCount < NTP_SERVERS_MAX || stale < NTP_SERVERS_MAX) {
+      if (this->_serverCount < NTP_SERVERS_MAX)
+        this->_serverCount++;
+      else
+        i = stale;  // expired and not returned again
+      this->_servers[i].address = address;
+      this->_servers[i].failures = 0;
+      this->_servers[i].expires = now + NTP_DNS_TTL;
+      this->_nextLookup = now + NTP_DNS_INTERVAL;
+      return;  // more may come
+    }
+  }
+  else
+    this->_servers[i].expires = now + NTP_DNS_TTL;
+
+  // Nothing new taken: look up again as the first address expires
+  this->_nextLookup = now + NTP_DNS_TTL;
+  for (i = 0; i < this->_serverCount; i++)
+    if ((long) (this->_servers[i].expires - this->_nextLookup) < 0)
+      this->_nextLookup = this->_servers[i].expires;
+}
+
+void NTPClient::dropServer(uint8_t index) {
+  for (uint8_t i = index; i + 1 < this->_serverCount; i++)
+    this->_servers[i] = this->_servers[i + 1];
+  this->_serverCount--;
+}
+
+bool NTPClient::sendRound() {
+  this->_requestedAt = millis();
+  this->_pendingCount = 0;
+  this->_roundCount = 0;
+  // Pipelined on the socket; replies are told apart by their originate
+  for (uint8_t i = 0; i < this->_serverCount; i++) {
+    this->_requests[i].pending = this->sendNTPPacket(this->_servers[i].address, i);
+    if (this->_requests[i].pending)
+      this->_pendingCount++;
+  }
+  return this->_pendingCount > 0;
+}
+
+void NTPClient::takeReply(uint64_t mono) {
+  unsigned long now = millis();
+  uint8_t i;
 
   this->_udp.read(this->_packetBuffer, NTP_PACKET_SIZE);
 
-  unsigned long highWord = word(this->_packetBuffer[40], this->_packetBuffer[41]);
-  unsigned long lowWord = word(this->_packetBuffer[42], this->_packetBuffer[43]);
-  // combine the four bytes (two words) into a long integer
-  // this is NTP time (seconds since Jan 1 1900):
-  unsigned long secsSince1900 = highWord << 16 | lowWord;
+  // A reply to another request is skipped, ie. one that timed out
+  for (i = 0; i < this->_serverCount; i++)
+    if (this->_requests[i].pending &&
+        memcmp(this->_packetBuffer + 24, this->_requests[i].origin, 8) == 0 &&
+        this->_udp.remoteIP() == this->_servers[i].address)
+      break;
+  if (i == this->_serverCount)
+    return;
+  this->_requests[i].pending = false;
+  this->_pendingCount--;
+
+  // Server mode, synchronized, and not a kiss-o'-death stratum 0
+  byte leap = this->_packetBuffer[0] >> 6, mode = this->_packetBuffer[0] & 7;
+  byte stratum = this->_packetBuffer[1];
+  if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15) {
+    this->_servers[i].failures++;
+    return;
+  }
+  this->_servers[i].failures = 0;
+
+  // Round trip less the server time between receive T2 and transmit T3.
+  // The reply is taken within NTP_POLL_INTERVAL of its arrival, which adds
+  // up to half of that to the time below.
+  uint64_t received = ntpToEpochMillis(this->_packetBuffer + 32);
+  uint64_t transmitted = ntpToEpochMillis(this->_packetBuffer + 40);
+  long roundTrip = (long) (now - this->_requests[i].sentAt) - (long) (transmitted - received);
+  if (roundTrip < 0)
+    roundTrip = 0;
+
+  // Server time at now is T3 plus the way back, half of the round trip.
+  // Against the local clock this is the offset
+  // ((T2 - T1) + (T3 - T4)) / 2, with T1 and T4 sent and taken on it.
+  NTPSample *sample = &this->_roundSamples[this->_roundCount++];
+  sample->epochMillis = transmitted + roundTrip / 2;
+  sample->mono = mono;
+  sample->offset = (long) (int64_t) (sample->epochMillis - this->getLocalMillis(mono));
+  sample->delay = roundTrip;
+}
+
+bool NTPClient::finishRound() {
+  uint8_t i, j, n = this->_roundCount;
+  long offsets[NTP_SERVERS_MAX], median;
+
+  // Servers that did not answer well, dropped after some rounds so that
+  // lookups replace them
+  for (i = this->_serverCount; i-- > 0; ) {
+    if (this->_requests[i].pending)
+      this->_servers[i].failures++;
+    if (this->_servers[i].failures >= NTP_SERVER_FAILS)
+      this->dropServer(i);
+  }
+  this->_pendingCount = 0;
+  if (n == 0) {
+    this->complete(false);
+    return false;
+  }
+
+  // Reject samples far off the median of the round, ie. a server with a
+  // wrong clock; offsets are all against the same local clock
+  for (i = 0; i < n; i++) {
+    long v = this->_roundSamples[i].offset;
+    for (j = i; j > 0 && offsets[j - 1] > v; j--)
+      offsets[j] = offsets[j - 1];
+    offsets[j] = v;
+  }
+  median = n % 2 ? offsets[n / 2] : offsets[n / 2 - 1] / 2 + offsets[n / 2] / 2;
+  for (i = 0; i < n; i++) {
+    NTPSample *sample = &this->_roundSamples[i];
+    long off = sample->offset - median;
+    if ((off < 0 ? -off : off) > NTP_OUTLIER_MS + (long) sample->delay)
+      continue;
+    this->_filter[(this->_filterHead + this->_filterCount) % NTP_FILTER_SIZE] = *sample;
+    if (this->_filterCount < NTP_FILTER_SIZE)
+      this->_filterCount++;
+    else
+      this->_filterHead = (this->_filterHead + 1) % NTP_FILTER_SIZE;
+  }
+
+  // Clock filter: the least delayed of the samples not older than the
+  // one last used, as its time has the least network asymmetry in it
+  NTPSample *best = NULL;
+  for (i = 0; i < this->_filterCount; i++) {
+    NTPSample *sample = &this->_filter[(this->_filterHead + i) % NTP_FILTER_SIZE];
+    if (this->_timeSet && sample->mono <= this->_lastUpdate)
+      continue;
+    if (best == NULL || sample->delay < best->delay)
+      best = sample;
+  }
+  if (best == NULL) {
+    this->complete(false);  // all off the median
+    return false;
+  }
+  this->_roundTrip = best->delay;
+  this->discipline(best->epochMillis, best->mono);
+  this->complete(true);
+  return true;
+}
+
+void NTPClient::discipline(uint64_t epochMillis, uint64_t mono) {
+  uint64_t span = mono - this->_lastUpdate;
+
+  if (!this->_timeSet) {
+    this->_offset = 0;
+    this->_epochMillis = epochMillis;
+    this->_lastUpdate = mono;
+    return;
+  }
 
-  this->_currentEpoc = secsSince1900 - SEVENZYYEARS;
+  // Offset left after the frequency correction since the last reply
+  int64_t offset = (int64_t) (epochMillis - this->getLocalMillis(mono));
+  this->_offset = (long) offset;
+
+  // Frequency error from what accumulated over the span; the first
+  // sample is taken whole, later ones averaged in. Spans too short
+  // for the network noise to wash out are skipped.
+  if (span >= NTP_FREQ_MIN_SPAN) {
+    int64_t sample = offset * 1000000000LL / (int64_t) span;
+    int64_t drift = this->_drift + (this->_freqSamples == 0 ? sample : sample / NTP_FREQ_GAIN);
+    if (drift > NTP_FREQ_LIMIT) drift = NTP_FREQ_LIMIT;
+    if (drift < -NTP_FREQ_LIMIT) drift = -NTP_FREQ_LIMIT;
+    this->_drift = (int32_t) drift;
+    if (this->_freqSamples < 0xffff)
+      this->_freqSamples++;
+  }
+
+  // Stretch the interval while the corrected clock holds, shrink it back
+  // when it drifted away; not before a frequency estimate is there
+  long steady = this->_roundTrip / 2 > NTP_OFFSET_STEADY ? this->_roundTrip / 2 : NTP_OFFSET_STEADY;
+  long error = offset < 0 ? (long) -offset : (long) offset;
+  if (this->_freqSamples > 0 && error <= steady && this->_pollInterval < this->_maxInterval)
+    this->_pollInterval = this->_pollInterval * 2 < this->_maxInterval ? this->_pollInterval * 2 : this->_maxInterval;
+  else if (error > 4 * steady && this->_pollInterval > this->_updateInterval)
+    this->_pollInterval = this->_pollInterval / 2 > this->_updateInterval ? this->_pollInterval / 2 : this->_updateInterval;
+
+  // Step to the server time
+  this->_epochMillis = epochMillis;
+  this->_lastUpdate = mono;
 }
 
-void NTPClient::update() {
-  unsigned long runtime = millis();
-  if (runtime - this->_lastUpdate >= this->_updateInterval && this->_updateInterval != 0) {
-    this->forceUpdate();
+void NTPClient::complete(bool success) {
+  unsigned long now = millis();
+
+  this->_state = NTP_IDLE;
+  if (success) {
+    this->_timeSet = true;
+    this->_failCount = 0;
+    this->_retryDelay = NTP_RETRY_MIN;
+    this->_requestDue = this->_pollInterval != 0;
+    this->_nextRequest = now + this->_pollInterval;
+  }
+  else {
+    // retry sooner than the update interval, backing off
+    unsigned long limit = this->_updateInterval ? this->_updateInterval : NTP_RETRY_MAX;
+    if (this->_failCount < 255)
+      this->_failCount++;
+    this->_requestDue = true;
+    this->_nextRequest = now + this->_retryDelay;
+    this->_retryDelay = this->_retryDelay * 2 < limit ? this->_retryDelay * 2 : limit;
   }
+  if (this->_callback)
+    this->_callback(success);
+}
+
+void NTPClient::setTimeout(unsigned int timeout) {
+  this->_timeout = timeout;
+}
+
+void NTPClient::setCallback(NTPCallback callback) {
+  this->_callback = callback;
+}
+
+long NTPClient::getTimeToUpdate() {
+  unsigned long now = millis();
+
+  if (this->_state == NTP_WAITING) {
+    long left = (long) (this->_requestedAt + this->_timeout - now);
+    if (left <= 0)
+      return 0;
+    return left < NTP_POLL_INTERVAL ? left : NTP_POLL_INTERVAL;
+  }
+  if (!this->_requestDue)
+    return -1;
+  long left = (long) (this->_nextRequest - now);
+  if (left <= 0 && this->_serverCount == 0 && this->_lookupState == NTP_LOOKUP_PENDING)
+    return NTP_POLL_INTERVAL;  // request waits for the address
+  return left > 0 ? left : 0;
+}
+
+bool NTPClient::isTimeSet() {
+  return this->_timeSet;
+}
+
+bool NTPClient::isWaiting() {
+  return this->_state == NTP_WAITING;
+}
+
+uint8_t NTPClient::getFailCount() {
+  return this->_failCount;
+}
+
+uint64_t NTPClient::getMonotonicMillis() {
+  // Called from update() at least once per wrap of millis()
+  unsigned long now = millis();
+  if (now < this->_lastMillis)
+    this->_millisHigh += 0x100000000ULL;
+  this->_lastMillis = now;
+  return this->_millisHigh | now;
+}
+
+uint64_t NTPClient::getLocalMillis(uint64_t mono) {
+  int64_t elapsed = (int64_t) (mono - this->_lastUpdate);
+  return this->_epochMillis + elapsed + elapsed * this->_drift / 1000000000LL;
+}
+
+uint64_t NTPClient::getEpochMillis() {
+  return (int64_t) this->_timeOffset * 1000 +          // User offset
+         this->getLocalMillis(this->getMonotonicMillis()); // Server time interpolated since last update
 }
 
 unsigned long NTPClient::getRawTime() {
-  return this->_timeOffset + // User offset
-         this->_currentEpoc + // Epoc returned by the NTP server
-         ((millis() - this->_lastUpdate) / 1000); // Time since last update
+  return this->getEpochMillis() / 1000;
+}
+
+long NTPClient::getOffset() {
+  return this->_offset;
+}
+
+unsigned long NTPClient::getRoundTrip() {
+  return this->_roundTrip;
+}
+
+int32_t NTPClient::getDrift() {
+  return this->_drift;
+}
+
+unsigned long NTPClient::getUpdateInterval() {
+  return this->_pollInterval;
+}
+
+uint8_t NTPClient::getServerCount() {
+  return this->_serverCount;
+}
+
+void NTPClient::setMaxUpdateInterval(unsigned long interval) {
+  this->_maxInterval = interval > this->_updateInterval ? interval : this->_updateInterval;
+  if (this->_pollInterval > this->_maxInterval)
+    this->_pollInterval = this->_maxInterval;
 }
 
 String NTPClient::getHours() {
@@ -108,20 +556,84 @@ String NTPClient::getSeconds() {
 }
 
 String NTPClient::getFormattedTime() {
+  return String(this->getTimeString());
+}
+
+void NTPClient::refreshLocalTime() {
   unsigned long rawTime = this->getRawTime();
-  unsigned long hours = (rawTime % 86400L) / 3600;
-  String hoursStr = hours < 10 ? "0" + String(hours) : String(hours);
+  if (this->_cacheValid && rawTime == this->_cacheSecond)
+    return;
+
+  unsigned long days = rawTime / 86400L;
+  unsigned long secs = rawTime % 86400L;
+  struct tm *tv = &this->_cacheTm;
+
+  if (!this->_cacheValid || days != this->_cacheDay) {
+    int year, month, day;
+    bool leap;
+    civilFromDays(days, &year, &month, &day);
+    leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    memset(tv, 0, sizeof(*tv));
+    tv->tm_year = year - 1900;
+    tv->tm_mon = month - 1;
+    tv->tm_mday = day;
+    tv->tm_wday = (days + 4) % 7;  // 1970-01-01 was a Thursday
+    tv->tm_yday = daysBeforeMonth[month - 1] + day - 1 + (leap && month > 2);
+
+    char *p = this->_cacheDate;
+    p = appendNumber(p, year);
+    *p++ = '.';
+    p = appendNumber(p, month);
+    *p++ = '.';
+    p = appendNumber(p, day);
+    *p++ = ' ';
+    *p++ = '(';
+    const char *name = this->_weekdays[tv->tm_wday];
+    while (*name && p < this->_cacheDate + NTP_DATE_SIZE - 2)
+      *p++ = *name++;
+    *p++ = ')';
+    *p = '\0';
+    this->_cacheDay = days;
+  }
+
+  tv->tm_hour = secs / 3600;
+  tv->tm_min = secs / 60 % 60;
+  tv->tm_sec = secs % 60;
+  char *t = this->_cacheTime;
+  t[0] = '0' + tv->tm_hour / 10;
+  t[1] = '0' + tv->tm_hour % 10;
+  t[2] = ':';
+  t[3] = '0' + tv->tm_min / 10;
+  t[4] = '0' + tv->tm_min % 10;
+  t[5] = ':';
+  t[6] = '0' + tv->tm_sec / 10;
+  t[7] = '0' + tv->tm_sec % 10;
+  t[8] = '\0';
+  this->_cacheSecond = rawTime;
+  this->_cacheValid = true;
+}
 
-  unsigned long minutes = (rawTime % 3600) / 60;
-  String minuteStr = minutes < 10 ? "0" + String(minutes) : String(minutes);
+const struct tm* NTPClient::getBrokenDownTime() {
+  this->refreshLocalTime();
+  return &this->_cacheTm;
+}
 
-  unsigned long seconds = rawTime % 60;
-  String secondStr = seconds < 10 ? "0" + String(seconds) : String(seconds);
+const char* NTPClient::getDateString() {
+  this->refreshLocalTime();
+  return this->_cacheDate;
+}
+
+const char* NTPClient::getTimeString() {
+  this->refreshLocalTime();
+  return this->_cacheTime;
+}
 
-  return hoursStr + ":" + minuteStr + ":" + secondStr;
+void NTPClient::setWeekdayNames(const char* const* names) {
+  this->_weekdays = names ? names : weekdaysEnglish;
+  this->_cacheValid = false;
 }
 
-void NTPClient::sendNTPPacket(IPAddress ip) {
+bool NTPClient::sendNTPPacket(IPAddress ip, uint8_t index) {
   // set all bytes in the buffer to 0
   memset(this->_packetBuffer, 0, NTP_PACKET_SIZE);
   // Initialize values needed to form NTP request
@@ -135,10 +647,18 @@ void NTPClient::sendNTPPacket(IPAddress ip) {
   this->_packetBuffer[13]  = 0x4E;
   this->_packetBuffer[14]  = 49;
   this->_packetBuffer[15]  = 52;
+  // Transmit timestamp T1 on the local clock, returned as originate;
+  // the lowest fraction byte, below a microsecond, tells requests apart
+  NTPRequest *request = &this->_requests[index];
+  request->sentAt = millis();
+  epochMillisToNtp(this->getLocalMillis(this->getMonotonicMillis()), this->_packetBuffer + 40);
+  this->_packetBuffer[47] = index;
+  memcpy(request->origin, this->_packetBuffer + 40, sizeof(request->origin));
 
   // all NTP fields have been given values, now
   // you can send a packet requesting a timestamp:
-  this->_udp.beginPacket(ip, 123); //NTP requests are to port 123
+  if (!this->_udp.beginPacket(ip, 123)) //NTP requests are to port 123
+    return false;
   this->_udp.write(this->_packetBuffer, NTP_PACKET_SIZE);
-  this->_udp.endPacket();
+  return this->_udp.endPacket();
 }
@@ -2,12 +2,84 @@
 
 #include "Arduino.h"
 
+#include <time.h>
 #include <WiFi.h>
 #include <WiFiUdp.h>
+#ifdef ESP8266
+extern "C" {
+#include <lwip/init.h>
+#include <lwip/dns.h>
+}
+#endif
 
 #define SEVENZYYEARS 2208988800UL
 #define NTP_PACKET_SIZE 48
 
+#define NTP_TIMEOUT       1000    // ms to wait for a reply
+#define NTP_POLL_INTERVAL 10      // ms between checks for the reply
+#define NTP_RETRY_MIN     2000    // ms to retry after a failure, doubling
+#define NTP_RETRY_MAX     600000  // ms, backoff limit without update interval
+
+// Clock discipline
+#define NTP_POLL_MAX      14400000UL  // ms, longest update interval reached
+#define NTP_FREQ_MIN_SPAN 60000   // ms between replies to take a frequency sample
+#define NTP_FREQ_GAIN     4       // later samples move the estimate by 1/gain
+#define NTP_FREQ_LIMIT    500000  // ppb, largest frequency error taken
+#define NTP_OFFSET_STEADY 10      // ms; offsets within this or half the round trip stretch the interval
+
+// Servers and samples
+#define NTP_SERVERS_MAX   4       // addresses of the pool queried each round
+#define NTP_SERVER_FAILS  3       // rounds without reply before an address is dropped
+#define NTP_DNS_TTL       3600000UL // ms an address is kept before looking it up again
+#define NTP_DNS_INTERVAL  60000   // ms between lookups while they find new addresses,
+                                  // and after a failed one, doubling up to NTP_DNS_TTL
+#define NTP_DNS_TIMEOUT   10000   // ms to give up on an asynchronous lookup
+#define NTP_DNS_LEAD      5000    // ms before a request when no lookup is started
+#define NTP_FILTER_SIZE   8       // recent samples the clock filter picks from
+#define NTP_OUTLIER_MS    100     // ms off the median, plus the round trip, to reject a sample
+
+// Formatted local time
+#define NTP_DATE_SIZE     32      // "YYYY.M.D (weekday)" with a weekday name of up to 15 bytes
+#define NTP_TIME_SIZE     9       // "HH:MM:SS"
+
+// Request state driven by update()
+enum NTPState {
+  NTP_IDLE,
+  NTP_WAITING
+};
+
+// Address lookup of the pool, answered in the resolver callback
+enum NTPLookupState {
+  NTP_LOOKUP_IDLE,
+  NTP_LOOKUP_PENDING,
+  NTP_LOOKUP_DONE               // _lookupAddress set, 0 if not found
+};
+
+// Called as a request completes, false on timeout or lookup failure
+typedef void (*NTPCallback)(bool success);
+
+// Cached address of the pool
+struct NTPServer {
+  IPAddress     address;
+  unsigned long expires;        // millis() to look it up again
+  uint8_t       failures;       // rounds in a row without a good reply
+};
+
+// Request of a round, one per server
+struct NTPRequest {
+  byte          origin[8];      // transmit timestamp, returned as originate
+  unsigned long sentAt;
+  bool          pending;
+};
+
+// Server time at a monotonic ms, and the round trip it was taken with
+struct NTPSample {
+  uint64_t      epochMillis;
+  uint64_t      mono;
+  long          offset;         // against the local clock at mono
+  unsigned long delay;
+};
+
 class NTPClient {
   private:
     WiFiUDP       _udp;
@@ -16,14 +88,80 @@ class NTPClient {
     int           _port           = 1337;
     int           _timeOffset;
 
-    unsigned int  _updateInterval = 60000;  // In ms
+    unsigned int  _updateInterval = 60000;  // In ms, shortest
+    unsigned long _maxInterval    = NTP_POLL_MAX;
+    unsigned long _pollInterval   = 60000;  // In ms, stretched as the clock settles
 
-    unsigned long _currentEpoc;             // In s
-    unsigned long _lastUpdate     = 0;      // In ms
+    // 64 bit millis() not to wrap after 49.7 days
+    unsigned long _lastMillis     = 0;
+    uint64_t      _millisHigh     = 0;
+
+    uint64_t      _epochMillis    = 0;      // Server time at _lastUpdate, ms since 1970
+    uint64_t      _lastUpdate     = 0;      // Monotonic ms
+    int32_t       _drift          = 0;      // Local clock frequency correction, ppb
+    uint16_t      _freqSamples    = 0;
+    long          _offset         = 0;      // Last correction of the local clock, ms
+    unsigned long _roundTrip      = 0;      // Last network delay, ms
 
     byte          _packetBuffer[NTP_PACKET_SIZE];
 
-    void          sendNTPPacket(IPAddress _timeServerIP);
+    NTPState      _state          = NTP_IDLE;
+    bool          _requestDue     = false;  // _nextRequest is set
+    unsigned long _nextRequest    = 0;      // millis() to send at
+    unsigned long _requestedAt    = 0;      // Round start
+
+    NTPServer     _servers[NTP_SERVERS_MAX];
+    uint8_t       _serverCount    = 0;
+    unsigned long _nextLookup     = 0;
+    unsigned long _lookupBackoff  = NTP_DNS_INTERVAL;
+    bool          _lookedUp       = false;
+    bool          _lookupWaited   = false;  // Request due waits for the lookup
+    volatile uint8_t  _lookupState   = NTP_LOOKUP_IDLE;
+    volatile uint32_t _lookupAddress = 0;
+    unsigned long _lookupStarted  = 0;
+    NTPRequest    _requests[NTP_SERVERS_MAX];   // by server
+    uint8_t       _pendingCount   = 0;
+    NTPSample     _roundSamples[NTP_SERVERS_MAX];
+    uint8_t       _roundCount     = 0;
+    NTPSample     _filter[NTP_FILTER_SIZE];     // ring of accepted samples
+    uint8_t       _filterHead     = 0;
+    uint8_t       _filterCount    = 0;
+    unsigned int  _timeout        = NTP_TIMEOUT;
+    unsigned long _retryDelay     = NTP_RETRY_MIN;
+    uint8_t       _failCount      = 0;
+    bool          _timeSet        = false;
+    NTPCallback   _callback       = NULL;
+
+    // Local time cache, formatted again only when the second or day changes
+    const char* const* _weekdays;
+    bool          _cacheValid     = false;
+    unsigned long _cacheSecond    = 0;
+    unsigned long _cacheDay       = 0;
+    struct tm     _cacheTm;
+    char          _cacheDate[NTP_DATE_SIZE];
+    char          _cacheTime[NTP_TIME_SIZE];
+
+    bool          sendNTPPacket(IPAddress _timeServerIP, uint8_t index);
+    void          refreshServers(bool force);
+    void          startLookup();
+    void          pollLookup();
+    void          takeAddress(IPAddress address);
+#ifdef ESP8266
+#if LWIP_VERSION_MAJOR == 1
+    static void   lookupFound(const char* name, ip_addr_t* ipaddr, void* arg);
+#else
+    static void   lookupFound(const char* name, const ip_addr_t* ipaddr, void* arg);
+#endif
+#endif
+    void          dropServer(uint8_t index);
+    bool          sendRound();
+    void          takeReply(uint64_t mono);
+    bool          finishRound();
+    void          complete(bool success);
+    uint64_t      getMonotonicMillis();
+    uint64_t      getLocalMillis(uint64_t mono);
+    void          refreshLocalTime();
+    void          discipline(uint64_t epochMillis, uint64_t mono);
 
   public:
     NTPClient(int timeOffset);
@@ -31,14 +169,87 @@ class NTPClient {
     NTPClient(const char* poolServerName, int timeOffset);
     NTPClient(const char* poolServerName, int timeOffset, int updateInterval);
 
+    /**
+     * Open the socket and request the time; the reply is taken by update()
+     */
     void begin();
-    void update();
+
+    /**
+     * Send a request when due and take its reply, never waiting for it.
+     * Call from loop(); returns true when the time was set by this call.
+     */
+    bool update();
+
+    /**
+     * Request the time at the next update()
+     */
     void forceUpdate();
 
+    void setTimeout(unsigned int timeout);
+    void setCallback(NTPCallback callback);
+
+    /**
+     * ms until update() has work, 0 if now, -1 if no request is due
+     */
+    long getTimeToUpdate();
+    bool isTimeSet();
+    bool isWaiting();
+    // Consecutive failed requests
+    uint8_t getFailCount();
+
     String getHours();
     String getMinutes();
     String getSeconds();
     String getFormattedTime();
 
+    /**
+     * Local time of getRawTime(), broken down and formatted as
+     * "YYYY.M.D (weekday)" and "HH:MM:SS". Kept in the client and formatted
+     * again only when the second or the day changes, without the heap;
+     * valid until the next call of any of them.
+     */
+    const struct tm* getBrokenDownTime();
+    const char* getDateString();
+    const char* getTimeString();
+
+    /**
+     * Weekday names from Sunday for getDateString(), ie. in the display
+     * language; names[] is kept, not copied
+     */
+    void setWeekdayNames(const char* const* names);
+
     unsigned long getRawTime();
+
+    /**
+     * Time as getRawTime() in ms, interpolated with millis() since the
+     * last reply
+     */
+    uint64_t getEpochMillis();
+
+    /**
+     * Last reply: ms the local clock was set ahead, and the round trip
+     * less the time spent in the server
+     */
+    long getOffset();
+    unsigned long getRoundTrip();
+
+    /**
+     * Frequency error of the local clock estimated from successive
+     * replies, in ppb the local clock runs slow; getRawTime() is
+     * corrected for it
+     */
+    int32_t getDrift();
+
+    /**
+     * Update interval in use: from the one given, doubling up to the
+     * maximum while replies agree with the corrected clock, and halving
+     * when they do not
+     */
+    unsigned long getUpdateInterval();
+    void setMaxUpdateInterval(unsigned long interval);
+
+    /**
+     * Pool addresses cached, each queried on every request
+     */
+    uint8_t getServerCount();
 };
@@ -3,6 +3,8 @@
  * Lee yongjae, setu74p@gmail.com, 2017-05-10.
  */
 
+#include <string.h>
+#include <stdarg.h>
 #include <pgmspace.h>
 #include <OLEDDisplay.h>
 #include "utf8ncode.h"
@@ -37,6 +39,67 @@ NcodeFontDraw::fontBitmap(const char *font, int c)
   return NULL;
 }
 
+void
+NcodeFontDraw::setFallbackFonts(const NcodeFallbackFont *fonts, uint8_t count)
+{
+  int i, c, uc, lo, slot;
+
+  if (count > NCODE_FALLBACK_FONT_MAX)
+    count = NCODE_FALLBACK_FONT_MAX;
+  fallback_fonts = fonts;
+  fallback_count = count;
+  fallback_page_count = 0;
+  memset(fallback_page_slot, 0, sizeof(fallback_page_slot));
+
+  for (i = 0; i < count; i++) {
+    const char *font = fonts[i].font;
+    if (font == NULL)
+      continue;
+    int first_char = pgm_read_byte_near(font + 4);
+    int num_chars = pgm_read_byte_near(font + 5);
+
+    for (c = first_char; c < first_char + num_chars; c++) {
+      const char *pj = fontJumpEntry(font, c);
+      if (pgm_read_byte_near(pj + 2) == 0 && pgm_read_byte_near(pj + 3) == 0)
+        continue;  /* empty glyph; not covered */
+      uc = fonts[i].uc_base + c;
+      if (uc < 0 || uc > 0xffff)
+        continue;
+
+      if ((slot = fallback_page_slot[uc >> 8]) == 0) {
+        if (fallback_page_count >= NCODE_FALLBACK_PAGE_MAX)
+          continue;  /* out of page slots */
+        slot = ++fallback_page_count;
+        memset(&fallback_pages[slot - 1], 0, sizeof(fallback_pages[0]));
+        fallback_page_slot[uc >> 8] = slot;
+      }
+
+      lo = uc & 0xff;
+      if (fallback_pages[slot - 1].covered[lo >> 3] & (1 << (lo & 7)))
+        continue;  /* already covered by earlier font in chain */
+      fallback_pages[slot - 1].covered[lo >> 3] |= (1 << (lo & 7));
+      fallback_pages[slot - 1].font_index[lo >> 1] |= i << ((lo & 1) * 4);
+    }
+  }
+}
+
+const char *
+NcodeFontDraw::fallbackFont(int uc, int *c_ret)
+  /* returns fallback font and its char for uc, or NULL if not covered */
+{
+  int slot, lo, i;
+
+  if (uc < 0 || uc > 0xffff || (slot = fallback_page_slot[uc >> 8]) == 0)
+    return NULL;
+  lo = uc & 0xff;
+  if (!(fallback_pages[slot - 1].covered[lo >> 3] & (1 << (lo & 7))))
+    return NULL;
+  i = (fallback_pages[slot - 1].font_index[lo >> 1] >> ((lo & 1) * 4)) & 0x0f;
+
+  *c_ret = uc - fallback_fonts[i].uc_base;
+  return fallback_fonts[i].font;
+}
+
 int
 NcodeFontDraw::fontHeight(void)
 {
@@ -113,8 +176,12 @@ NcodeFontDraw::drawFont(OLEDDisplay *d, int ox, int oy, const char *font, int c)
     for (bx = 0; bx < bbw; bx += 8) {
       int b = pgm_read_byte_near(bitmap++);
       for (x = bx ; x < bbw && x < bx + 8; x++, b <<= 1) 
-        if ((b & 0x80))
-          d->setPixel(ox + x + bbox, oy + fascent - bboy - bbh + y);
+        if ((b & 0x80)) {
+          if (surface)
+            surface->setPixel(ox + x + bbox, oy + fascent - bboy - bbh + y);
+          else
+            d->setPixel(ox + x + bbox, oy + fascent - bboy - bbh + y);
+        }
     }
       
   return dwidth;
@@ -123,6 +190,7 @@ NcodeFontDraw::drawFont(OLEDDisplay *d, int ox, int oy, const char *font, int c)
 int
 NcodeFontDraw::fontWidthUc(int uc)
 {
+  const char *font;
   int c, w = 0;
   if (isHangleUc(uc) && advanced_ncode_render) {
     int c_cho = ucToNcodeCho(uc);
@@ -161,6 +229,12 @@ NcodeFontDraw::fontWidthUc(int uc)
     if ((c = ucToNcodeJong(uc)))
       w += fontWidth(ncode_font, c);
   }
+  else if ((c = utf32_jamo_to_ncode(uc))) {
+    w += fontWidth(ncode_font, c);  /* standalone jamo left after composing */
+  }
+  else if (fontJumpEntry(ascii_font, uc) == NULL && (font = fallbackFont(uc, &c))) {
+    w += fontWidth(font, c);
+  }
   else {
     w += fontWidth(ascii_font, uc);
   }
@@ -171,6 +245,7 @@ int
 NcodeFontDraw::drawFontUc(OLEDDisplay *d, int ox, int oy, int uc)
   /* returns font width */
 {
+  const char *font;
   int c, w = 0;
   if (isHangleUc(uc) && advanced_ncode_render) {
     int c_cho = ucToNcodeCho(uc);
@@ -225,15 +300,21 @@ NcodeFontDraw::drawFontUc(OLEDDisplay *d, int ox, int oy, int uc)
     if ((c = ucToNcodeJong(uc)))
       w += drawFont(d, ox + w, oy, ncode_font, c);
   }
+  else if ((c = utf32_jamo_to_ncode(uc))) {
+    w += drawFont(d, ox, oy, ncode_font, c);  /* standalone jamo left after composing */
+  }
+  else if (fontJumpEntry(ascii_font, uc) == NULL && (font = fallbackFont(uc, &c))) {
+    /* align fallback font baseline to ascii font's */
+    w += drawFont(d, ox, oy + fontAscent(ascii_font) - fontAscent(font), font, c);
+  }
   else {
     w += drawFont(d, ox, oy, ascii_font, uc);
   }
   return w;
 }
 
-void
-NcodeFontDraw::drawString(OLEDDisplay *d, int x, int y,
-                          int textAlign, const char *utf8_str)
+int
+NcodeFontDraw::getStringWidth(const char *utf8_str)
 {
   const char *s;
   int w, n, uc;
@@ -241,13 +322,159 @@ NcodeFontDraw::drawString(OLEDDisplay *d, int x, int y,
   w = 0;
   for (s = utf8_str; *s && (n = utf8_to_utf32((const unsigned char *)s, &uc)); s += n)
     w += fontWidthUc(uc);
+  return w;
+}
+
+void
+NcodeFontDraw::drawText(OLEDDisplay *d, int x, int y,
+                        int textAlign, const char *utf8_str, const char *utf8_end)
+  /* draw utf8_str ~ utf8_end; need not be NUL terminated */
+{
+  const char *s;
+  int w, n, uc;
+
+  w = 0;
+  for (s = utf8_str; s < utf8_end && (n = utf8_to_utf32((const unsigned char *)s, &uc)); s += n)
+    w += fontWidthUc(uc);
 
   if (textAlign == TEXT_ALIGN_CENTER)     x -= w / 2;
   else if (textAlign == TEXT_ALIGN_RIGHT) x -= w;
   else /* textAlign == TEXT_ALIGN_LEFT */ x -= 0;
 
-  for (s = utf8_str; *s && (n = utf8_to_utf32((const unsigned char *)s, &uc)); s += n)
+  for (s = utf8_str; s < utf8_end && (n = utf8_to_utf32((const unsigned char *)s, &uc)); s += n) {
+    if (surface && x >= surface->width)
+      break;  /* rest is out of surface */
     x += drawFontUc(d, x, y, uc);
+  }
+}
+
+void
+NcodeFontDraw::drawString(OLEDDisplay *d, int x, int y,
+                          int textAlign, const char *utf8_str)
+{
+  drawText(d, x, y, textAlign, utf8_str, utf8_str + strlen(utf8_str));
+}
+
+void
+NcodeFontDraw::drawString(Surface *surf, int x, int y,
+                          int textAlign, const char *utf8_str)
+{
+  surface = surf;
+  drawText(NULL, x, y, textAlign, utf8_str, utf8_str + strlen(utf8_str));
+  surface = NULL;
+}
+
+static char *
+format_pad(char *p, char *p_limit, const char *s, int len, int width, int left, char pad)
+  /* put s[0~len) padded to width; returns next p */
+{
+  int npad = (width > len)? width - len : 0;
+
+  if (!left)
+    for (; npad > 0 && p < p_limit; npad--)
+      *p++ = pad;
+  for (; len > 0 && p < p_limit; len--)
+    *p++ = *s++;
+  for (; npad > 0 && p < p_limit; npad--)
+    *p++ = ' ';
+  return p;
+}
+
+static int
+format_arena(char *buf, int buf_size, const char *fmt, va_list ap)
+  /* returns length of formatted string in buf; buf is not NUL terminated */
+{
+  char *p = buf, *p_limit = buf + buf_size;
+  char num[sizeof(unsigned long) * 3 + 2], *q;  /* digits of unsigned long and sign */
+  const char *s;
+  int width, left, is_long, neg, n;
+  char pad;
+  unsigned long v;
+
+  while (*fmt && p < p_limit) {
+    if (*fmt != '%') {
+      *p++ = *fmt++;
+      continue;
+    }
+    fmt++;
+    left = 0;
+    pad = ' ';
+    for (; *fmt == '-' || *fmt == '0'; fmt++)
+      if (*fmt == '-') left = 1;
+      else             pad = '0';
+    for (width = 0; *fmt >= '0' && *fmt <= '9'; fmt++)
+      width = width * 10 + (*fmt - '0');
+    if ((is_long = (*fmt == 'l')))
+      fmt++;
+
+    switch (*fmt) {
+    case 'd':
+    case 'u':
+      if (*fmt == 'd') {
+        long l = (is_long)? va_arg(ap, long) : va_arg(ap, int);
+        neg = (l < 0);
+        v = (neg)? -(unsigned long)l : (unsigned long)l;
+      } else {
+        v = (is_long)? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+        neg = 0;
+      }
+      /* digits from the end of num[] */
+      q = num + sizeof(num);
+      do { *--q = '0' + v % 10; v /= 10; } while (v);
+      if (neg && pad == '0' && !left) {
+        /* sign before zero padding */
+        *p++ = '-';
+        width--;
+      }
+      else if (neg) {
+        *--q = '-';
+      }
+      p = format_pad(p, p_limit, q, num + sizeof(num) - q, width, left, (left)? ' ' : pad);
+      break;
+    case 's':
+      s = va_arg(ap, const char *);
+      if (s == NULL)
+        s = "(null)";
+      p = format_pad(p, p_limit, s, strlen(s), width, left, ' ');
+      break;
+    case 'c':
+      num[0] = (char)va_arg(ap, int);
+      p = format_pad(p, p_limit, num, 1, width, left, ' ');
+      break;
+    case '%':
+      *p++ = '%';
+      break;
+    default:
+      /* unsupported conversion; stop formatting */
+      return p - buf;
+    }
+    fmt++;
+  }
+
+  /* drop utf8 char cut at the end of buf */
+  for (s = p; s > buf && s > p - 4 && (*(s - 1) & 0xc0) == 0x80; s--)
+    ;
+  if (s > buf && (*(s - 1) & 0x80)) {
+    n = ((*(s - 1) & 0xe0) == 0xc0)? 2 : ((*(s - 1) & 0xf0) == 0xe0)? 3 : 4;
+    if (s - 1 + n > p)
+      p = (char *)s - 1;
+  }
+  return p - buf;
+}
+
+void
+NcodeFontDraw::drawf(OLEDDisplay *d, int x, int y,
+                     int textAlign, const char *fmt, ...)
+{
+  char arena[NCODE_DRAWF_ARENA_SIZE];
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = format_arena(arena, sizeof(arena), fmt, ap);
+  va_end(ap);
+
+  drawText(d, x, y, textAlign, arena, arena + n);
 }
 
 void
@@ -7,12 +7,37 @@
 #define __NCODE_FONT_DRAW_H__
 
 #include <OLEDDisplay.h>
+#include "Surface.h"
+
+#define NCODE_DRAWF_ARENA_SIZE   64  /* max formatted bytes of drawf() */
+#define NCODE_FALLBACK_FONT_MAX  16  /* fonts in fallback chain; 4 bit index */
+#define NCODE_FALLBACK_PAGE_MAX  8   /* unicode pages (high bytes) covered */
+
+/* fallback font for codepoints not in the ascii/ncode fonts */
+struct NcodeFallbackFont {
+  const char *font;     /* ACF data */
+  int uc_base;          /* ACF char c is drawn for unicode uc_base + c */
+};
 
 class NcodeFontDraw {
 private:
   const char *ascii_font;   /* ASCII ACF data */
   const char *ncode_font;   /* NCODE ACF data */
   int advanced_ncode_render;
+  Surface *surface;         /* draw target instead of OLEDDisplay if set */
+
+  /* fallback chain: unicode high byte -> page slot (+1, 0 for none);
+     page: bitmap of covered low bytes and 4 bit font index per low byte */
+  const NcodeFallbackFont *fallback_fonts;
+  uint8_t fallback_count;
+  uint8_t fallback_page_slot[256];
+  struct {
+    uint8_t covered[32];
+    uint8_t font_index[128];
+  } fallback_pages[NCODE_FALLBACK_PAGE_MAX];
+  uint8_t fallback_page_count;
+
+  const char *fallbackFont(int uc, int *c_ret);
 
   int isHangleUc(int uc) {
     return (uc >= 44032 && uc <= 55195);
@@ -44,6 +69,9 @@ private:
   int fontWidthUc(int uc);
   int drawFontUc(OLEDDisplay *d, int ox, int oy, int uc);
 
+  void drawText(OLEDDisplay *d, int x, int y,
+                int textAlign, const char *utf8_str, const char *utf8_end);
+
 public:
   static const int TEXT_ALIGN_LEFT   = 0;
   static const int TEXT_ALIGN_CENTER = 1;
@@ -53,17 +81,37 @@ public:
     ascii_font = _ascii_font;
     ncode_font = _ncode_font;
     advanced_ncode_render = _advanced_ncode_render;
+    surface = NULL;
+    setFallbackFonts(NULL, 0);
   }
   void setFont(const char *_ascii_font, const char *_ncode_font) {
     ascii_font = _ascii_font;
     ncode_font = _ncode_font;
   }
 
+  /* set fallback chain tried in order for codepoints not in the ascii font;
+     fonts are looked up by a page table built here once */
+  void setFallbackFonts(const NcodeFallbackFont *fonts, uint8_t count);
+
+  int getFontHeight(void) {
+    return fontHeight();
+  }
+  int getStringWidth(const char *utf8_str);
+
   void drawString(OLEDDisplay *d, int x, int y,
                   int textAlign, const char *utf8_str);
+  void drawString(Surface *s, int x, int y,
+                  int textAlign, const char *utf8_str);
   void drawStringMaxWidth(OLEDDisplay *d, int x, int y,
                   int textAlign, int maxWidth, const char *utf8_str);
 
+  /* draw printf-style formatted string in one line without heap use;
+     supports %d %u %ld %lu %s %c %% with '0', '-' flags and width,
+     output over NCODE_DRAWF_ARENA_SIZE bytes is truncated */
+  void drawf(OLEDDisplay *d, int x, int y,
+             int textAlign, const char *fmt, ...)
+             __attribute__((format(printf, 6, 7)));
+
 };
 
 #endif  /* __NCODE_FONT_DRAW_H__ */
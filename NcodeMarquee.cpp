@@ -0,0 +1,77 @@
+/*
+ * NcodeMarquee.cpp - Scroll a one line utf8 string with NcodeFontDraw
+ */
+
+#include <Arduino.h>
+#include <OLEDDisplay.h>
+#include "NcodeMarquee.h"
+
+
+void
+NcodeMarquee::setText(const char *_ascii_font, const char *_ncode_font, const char *utf8_str)
+{
+  int pages;
+
+  ascii_font = _ascii_font;
+  ncode_font = _ncode_font;
+  text = utf8_str;
+
+  nfd->setFont(ascii_font, ncode_font);
+  text_width = nfd->getStringWidth(text);
+  period = text_width + NCODE_MARQUEE_GAP;
+
+  /* some margin for hangul shifted down to center its bound box */
+  pages = (nfd->getFontHeight() + 4 + 7) / 8;
+  strip.setSize(NCODE_MARQUEE_STRIP_BYTES / pages, pages);
+
+  start_millis = millis();
+  chunk_x = -1;
+  renderChunk(0);
+}
+
+void
+NcodeMarquee::renderChunk(int x0)
+  /* render text so that strip column 0 is scroll offset x0 */
+{
+  int tx;
+
+  strip.clear();
+  nfd->setFont(ascii_font, ncode_font);
+  if (!isScrolling()) {
+    nfd->drawString(&strip, 0, 0, nfd->TEXT_ALIGN_LEFT, text);
+  }
+  else {
+    /* repeat text by period; whole text fits when period + window <= strip,
+       then this is the only rendering done */
+    for (tx = -(x0 % period); tx < strip.width; tx += period)
+      nfd->drawString(&strip, tx, 0, nfd->TEXT_ALIGN_LEFT, text);
+  }
+  chunk_x = x0;
+  render_count++;
+}
+
+int
+NcodeMarquee::getOffset(void)
+{
+  if (!isScrolling())
+    return 0;
+  return (uint64_t)(millis() - start_millis) * speed / 1000 % period;
+}
+
+void
+NcodeMarquee::draw(OLEDDisplay *d, int x, int y)
+{
+  int off;
+
+  if (text == NULL)
+    return;
+  if (!isScrolling()) {
+    strip.blitTo(d, x + (window_width - text_width) / 2, y, 0, text_width);
+    return;
+  }
+
+  off = getOffset();
+  if (chunk_x < 0 || off < chunk_x || off + window_width > chunk_x + strip.width)
+    renderChunk(off);  /* window is out of strip */
+  strip.blitTo(d, x, y, off - chunk_x, window_width);
+}
@@ -0,0 +1,71 @@
+/*
+ * NcodeMarquee.h - Scroll a one line utf8 string with NcodeFontDraw
+ *
+ * The text is rendered once into an offscreen strip when set, and each
+ * draw only blits the visible window out of the strip. Text longer than
+ * the strip memory budget is rendered in chunks as the window moves on.
+ */
+
+#ifndef __NCODE_MARQUEE_H__
+#define __NCODE_MARQUEE_H__
+
+#include <OLEDDisplay.h>
+#include "Surface.h"
+#include "NcodeFontDraw.h"
+
+#define NCODE_MARQUEE_STRIP_BYTES  1536  /* strip memory budget */
+#define NCODE_MARQUEE_GAP          32    /* px between end and restart of text */
+
+class NcodeMarquee {
+private:
+  NcodeFontDraw *nfd;
+  const char *ascii_font;
+  const char *ncode_font;
+  const char *text;         /* utf8 string; must be kept while set */
+
+  uint8_t strip_buf[NCODE_MARQUEE_STRIP_BYTES];
+  Surface strip;
+
+  int text_width;           /* px */
+  int period;               /* text_width + gap */
+  int chunk_x;              /* scroll offset at strip column 0; -1 for none */
+  int window_width;
+  uint16_t speed;           /* px per second */
+  unsigned long start_millis;
+  uint32_t render_count;
+
+  void renderChunk(int x0);
+
+public:
+  NcodeMarquee(NcodeFontDraw *_nfd, int _window_width = DISPLAY_WIDTH, uint16_t _speed = 30)
+    : strip(strip_buf, 0, 0) {
+    nfd = _nfd;
+    text = NULL;
+    text_width = 0;
+    period = 1;
+    chunk_x = -1;
+    window_width = _window_width;
+    speed = _speed;
+    start_millis = 0;
+    render_count = 0;
+  }
+
+  /* set text and render it into strip; restarts scrolling */
+  void setText(const char *_ascii_font, const char *_ncode_font, const char *utf8_str);
+  void setSpeed(uint16_t _speed) {
+    speed = _speed;
+  }
+
+  bool isScrolling(void) {
+    return text_width > window_width;
+  }
+  int getOffset(void);
+  uint32_t getRenderCount(void) {
+    return render_count;
+  }
+
+  /* draw window at x, y; text narrower than window is centered */
+  void draw(OLEDDisplay *d, int x, int y);
+};
+
+#endif  /* __NCODE_MARQUEE_H__ */
@@ -33,23 +33,39 @@
  */
 
 #include "OLEDDisplayUiAux.h"
+#include "WidgetScreen.h"
+
+// Easing curves at 65 points over transition time, position in Q8.8
+static const int16_t EASING_IN_OUT[65] PROGMEM = {
+     0,    0,    0,    0,    0,    0,    1,    1,    2,    3,    4,    5,    7,
+     9,   11,   13,   16,   19,   23,   27,   31,   36,   42,   48,   54,   61,
+    69,   77,   86,   95,  105,  116,  128,  140,  151,  161,  170,  179,  187,
+   195,  202,  208,  214,  220,  225,  229,  233,  237,  240,  243,  245,  247,
+   249,  251,  252,  253,  254,  255,  255,  256,  256,  256,  256,  256,  256,
+};
+
+static const int16_t EASING_OVERSHOOT[65] PROGMEM = {
+     0,   18,   36,   53,   69,   84,   99,  113,  126,  139,  151,  162,  173,
+   183,  192,  201,  209,  217,  224,  231,  237,  243,  248,  253,  257,  261,
+   265,  268,  271,  273,  275,  277,  278,  280,  280,  281,  281,  282,  282,
+   281,  281,  280,  279,  278,  277,  276,  275,  274,  272,  271,  270,  268,
+   267,  265,  264,  263,  261,  260,  259,  258,  258,  257,  256,  256,  256,
+};
 
 OLEDDisplayUiAux::OLEDDisplayUiAux(OLEDDisplay *display) {
   this->display = display;
+#ifdef OLEDDISPLAYUI_PROFILE
+  this->resetProfile();
+#endif
 }
 
 void OLEDDisplayUiAux::init() {
   this->display->init();
+  this->shadowValid = false;
 }
 
 void OLEDDisplayUiAux::setTargetFPS(uint8_t fps){
-  float oldInterval = this->updateInterval;
-  this->updateInterval = ((float) 1.0 / (float) fps) * 1000;
-
-  // Calculate new ticksPerFrame
-  float changeRatio = oldInterval / (float) this->updateInterval;
-  this->ticksPerFrame *= changeRatio;
-  this->ticksPerTransition *= changeRatio;
+  this->updateInterval = 1000 / fps;
 }
 
 // -/------ Automatic controll ------\-
@@ -69,10 +85,10 @@ void OLEDDisplayUiAux::setAutoTransitionBackwards(){
   this->lastTransitionDirection = -1;
 }
 void OLEDDisplayUiAux::setTimePerFrame(uint16_t time){
-  this->ticksPerFrame = (int) ( (float) time / (float) updateInterval);
+  this->timePerFrame = time;
 }
 void OLEDDisplayUiAux::setTimePerTransition(uint16_t time){
-  this->ticksPerTransition = (int) ( (float) time / (float) updateInterval);
+  this->timePerTransition = time;
 }
 
 // -/------ Customize indicator position and style -------\-
@@ -86,23 +102,33 @@ void OLEDDisplayUiAux::disableIndicator(){
 
 void OLEDDisplayUiAux::enableAllIndicators(){
   this->shouldDrawIndicators = true;
+  this->invalidateComposite();
 }
 
 void OLEDDisplayUiAux::disableAllIndicators(){
   this->shouldDrawIndicators = false;
+  this->invalidateComposite();
 }
 
 void OLEDDisplayUiAux::setIndicatorPosition(IndicatorPosition pos) {
   this->indicatorPosition = pos;
+  this->indicatorLayerValid = false;
+  this->invalidateComposite();
 }
 void OLEDDisplayUiAux::setIndicatorDirection(IndicatorDirection dir) {
   this->indicatorDirection = dir;
+  this->indicatorLayerValid = false;
+  this->invalidateComposite();
 }
 void OLEDDisplayUiAux::setActiveSymbol(const char* symbol) {
   this->activeSymbol = symbol;
+  this->indicatorLayerValid = false;
+  this->invalidateComposite();
 }
 void OLEDDisplayUiAux::setInactiveSymbol(const char* symbol) {
   this->inactiveSymbol = symbol;
+  this->indicatorLayerValid = false;
+  this->invalidateComposite();
 }
 
 
@@ -110,21 +136,279 @@ void OLEDDisplayUiAux::setInactiveSymbol(const char* symbol) {
 void OLEDDisplayUiAux::setFrameAnimation(AnimationDirection dir) {
   this->frameAnimationDirection = dir;
 }
+void OLEDDisplayUiAux::setTransitionEasing(TransitionEasing easing) {
+  this->transitionEasing = easing;
+}
+// -/----- Frame registry -----\-
+int8_t OLEDDisplayUiAux::addFrame(FrameCallback frameFunction, AuxCallback auxFunction, uint8_t priority) {
+  for (uint8_t id = 0; id < OLEDDISPLAYUI_MAX_FRAMES; id++) {
+    if (this->frames[id].frameFunction) continue;
+    this->frames[id] = FrameEntry();
+    this->frames[id].frameFunction = frameFunction;
+    this->frames[id].auxFunction = auxFunction;
+    this->frames[id].priority = priority;
+    this->rotation[this->frameCount++] = id;
+    this->sortRotation();
+    if (this->frameCount == 1) this->resetState();
+    return id;
+  }
+  return -1;
+}
+// Marks registry entry used by a widget screen, which callFrame() draws
+static void drawWidgetScreen(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+}
+int8_t OLEDDisplayUiAux::addFrame(WidgetScreen *screen, AuxCallback auxFunction, uint8_t priority) {
+  int8_t id = this->addFrame(drawWidgetScreen, auxFunction, priority);
+  if (id >= 0) this->frames[id].screen = screen;
+  return id;
+}
+void OLEDDisplayUiAux::removeFrame(uint8_t frame) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES || !this->frames[frame].frameFunction) return;
+  this->frames[frame].frameFunction = NULL;
+  if (frame == this->alertFrame) this->alertFrame = -1;
+  if (frame == this->frameLayerFrame) this->frameLayerFrame = -1;
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < this->frameCount; i++)
+    if (this->rotation[i] != frame) this->rotation[n++] = this->rotation[i];
+  this->frameCount = n;
+  // Do not draw removed frame any more
+  if (frame == this->state.currentFrame ||
+      (this->state.frameState == IN_TRANSITION && frame == this->getNextFrameNumber()))
+    this->resetState();
+}
+void OLEDDisplayUiAux::setFrameEnabled(uint8_t frame, bool enabled) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].enabled = enabled;
+}
+void OLEDDisplayUiAux::setFrameReady(uint8_t frame, ReadyCallback readyFunction) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].readyFunction = readyFunction;
+}
+void OLEDDisplayUiAux::setFrameAux(uint8_t frame, AuxCallback auxFunction) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].auxFunction = auxFunction;
+}
+void OLEDDisplayUiAux::setFramePriority(uint8_t frame, uint8_t priority) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].priority = priority;
+  this->sortRotation();
+}
+void OLEDDisplayUiAux::setFrameDwell(uint8_t frame, uint16_t time) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].dwell = time;
+}
+void OLEDDisplayUiAux::setFrameVersion(uint8_t frame, VersionCallback versionFunction) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].versionFunction = versionFunction;
+}
+void OLEDDisplayUiAux::setFrameInterval(uint8_t frame, uint16_t interval) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].interval = interval;
+}
+void OLEDDisplayUiAux::setLiveFrame(uint8_t frame, bool live) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  this->frames[frame].live = live;
+}
+bool OLEDDisplayUiAux::isLiveFrame(uint8_t frame) {
+  return this->frames[frame].live;
+}
+
 void OLEDDisplayUiAux::setFrames(FrameCallback* frameFunctions, uint8_t frameCount) {
-  this->frameFunctions = frameFunctions;
-  this->frameCount     = frameCount;
+  for (uint8_t id = 0; id < OLEDDISPLAYUI_MAX_FRAMES; id++)
+    this->frames[id] = FrameEntry();
+  this->frameCount = 0;
+  for (uint8_t i = 0; i < frameCount; i++)
+    this->addFrame(frameFunctions[i]);
   this->resetState();
 }
 void OLEDDisplayUiAux::setAuxes(AuxCallback* auxFunctions, uint8_t auxCount) {
-  this->auxFunctions = auxFunctions;
-  this->auxCount = auxCount;
+  for (uint8_t id = 0; id < OLEDDISPLAYUI_MAX_FRAMES; id++)
+    if (this->frames[id].frameFunction && auxCount)
+      this->frames[id].auxFunction = auxFunctions[id % auxCount];
+}
+void OLEDDisplayUiAux::setVersions(VersionCallback* versionFunctions, uint8_t versionCount) {
+  for (uint8_t id = 0; id < versionCount && id < OLEDDISPLAYUI_MAX_FRAMES; id++)
+    this->frames[id].versionFunction = versionFunctions[id];
   this->resetState();
 }
+void OLEDDisplayUiAux::setFrameIntervals(uint16_t* frameIntervals, uint8_t frameIntervalCount) {
+  for (uint8_t id = 0; id < frameIntervalCount && id < OLEDDISPLAYUI_MAX_FRAMES; id++)
+    this->frames[id].interval = frameIntervals[id];
+}
+
+void OLEDDisplayUiAux::sortRotation() {
+  // Insertion sort by priority descending, then id
+  for (uint8_t i = 1; i < this->frameCount; i++) {
+    uint8_t id = this->rotation[i];
+    int8_t j = i - 1;
+    while (j >= 0 && (this->frames[this->rotation[j]].priority < this->frames[id].priority ||
+                      (this->frames[this->rotation[j]].priority == this->frames[id].priority && this->rotation[j] > id))) {
+      this->rotation[j + 1] = this->rotation[j];
+      j--;
+    }
+    this->rotation[j + 1] = id;
+  }
+}
+
+int8_t OLEDDisplayUiAux::getRotationPosition(uint8_t id) {
+  for (uint8_t i = 0; i < this->frameCount; i++)
+    if (this->rotation[i] == id) return i;
+  return -1;
+}
+
+bool OLEDDisplayUiAux::isFrameShown(uint8_t id) {
+  FrameEntry *entry = &this->frames[id];
+  if (!entry->frameFunction || !entry->enabled) return false;
+  return !entry->readyFunction || (entry->readyFunction)(this->getRotationPosition(id), this->frameCount);
+}
+
+// Next shown frame in rotation from current one, current one if none
+int8_t OLEDDisplayUiAux::findNextFrame(int8_t dir) {
+  int8_t pos = this->getRotationPosition(this->state.currentFrame);
+  if (pos < 0) pos = dir > 0 ? -1 : 0;
+  for (uint8_t i = 0; i < this->frameCount; i++) {
+    pos = (pos + this->frameCount + (dir >= 0 ? 1 : -1)) % this->frameCount;
+    if (this->isFrameShown(this->rotation[pos])) return this->rotation[pos];
+  }
+  return this->state.currentFrame;
+}
+
+void OLEDDisplayUiAux::callAux(uint8_t id) {
+  if (!this->frames[id].auxFunction) return;
+  OLEDDISPLAYUI_PROFILE_BEGIN(t);
+  (this->frames[id].auxFunction)(this->getRotationPosition(id), this->frameCount);
+  OLEDDISPLAYUI_PROFILE_END(PROFILE_AUX, id, t);
+}
+
+uint16_t OLEDDisplayUiAux::getFrameDwell(uint8_t id) {
+  if (id == this->alertFrame) return this->frames[id].alertHold;
+  return this->frames[id].dwell ? this->frames[id].dwell : this->timePerFrame;
+}
+
+// -/----- Alerts -----\-
+void OLEDDisplayUiAux::raiseAlert(uint8_t frame, uint8_t priority, uint16_t hold) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES || !this->frames[frame].frameFunction || priority == 0) return;
+  FrameEntry *entry = &this->frames[frame];
+  if (frame == this->alertFrame && this->state.currentFrame == frame) {
+    // Raised again while shown: hold the new content from now on
+    entry->alertTime = millis();
+    this->alertMeasure = true;
+    this->state.stateSwitchTime = entry->alertTime;
+    this->state.timeSinceLastStateSwitch = 0;
+  } else if (entry->alertPriority == 0) {
+    entry->alertTime = millis();
+    entry->alertShown = false;
+  }
+  entry->alertPriority = priority;
+  entry->alertHold = hold;
+  // Check for preemption on the next update
+  this->updateNow = true;
+}
+
+void OLEDDisplayUiAux::clearAlert(uint8_t frame) {
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES) return;
+  if (frame == this->alertFrame) {
+    this->frames[frame].alertHold = 0;  // ends on the next update
+    this->updateNow = true;
+  } else {
+    this->frames[frame].alertPriority = 0;
+  }
+}
+
+int8_t OLEDDisplayUiAux::getAlertFrame() {
+  return this->alertFrame;
+}
+
+uint32_t OLEDDisplayUiAux::getAlertCount() {
+  return this->alertCount;
+}
+uint32_t OLEDDisplayUiAux::getAlertLatencyLast() {
+  return this->alertLatencyLast;
+}
+uint32_t OLEDDisplayUiAux::getAlertLatencyMax() {
+  return this->alertLatencyMax;
+}
+uint32_t OLEDDisplayUiAux::getAlertLatencyAverage() {
+  return this->alertCount ? this->alertLatencyTotal / this->alertCount : 0;
+}
+
+// Cut to the highest alert above the one shown; true if done
+bool OLEDDisplayUiAux::preemptAlert(unsigned long now) {
+  uint8_t priority = this->alertFrame >= 0 ? this->frames[this->alertFrame].alertPriority : 0;
+  int8_t best = -1;
+
+  for (uint8_t id = 0; id < OLEDDISPLAYUI_MAX_FRAMES; id++) {
+    FrameEntry *entry = &this->frames[id];
+    if (!entry->frameFunction || id == this->alertFrame || entry->alertPriority <= priority) continue;
+    priority = entry->alertPriority;
+    best = id;
+  }
+  if (best < 0) return false;
+
+  // Preempted alert stays raised and is shown again after this one
+  if (this->alertFrame < 0) this->alertReturnFrame = this->state.currentFrame;
+  this->alertFrame = best;
+  this->alertMeasure = !this->frames[best].alertShown;
+  this->frames[best].alertShown = true;
+
+  this->state.frameState = FIXED;
+  this->state.currentFrame = best;
+  this->state.stateSwitchTime = now;
+  this->state.timeSinceLastStateSwitch = 0;
+  this->state.isIndicatorDrawen = true;
+  this->nextFrameNumber = -1;
+  this->snapshotsTaken = false;
+  return true;
+}
+
+void OLEDDisplayUiAux::endAlert() {
+  this->frames[this->alertFrame].alertPriority = 0;
+  this->alertFrame = -1;
+  this->alertMeasure = false;
+}
+
+void OLEDDisplayUiAux::recordAlertLatency() {
+  uint32_t latency = millis() - this->frames[this->alertFrame].alertTime;
+  this->alertMeasure = false;
+  this->alertCount++;
+  this->alertLatencyLast = latency;
+  this->alertLatencyTotal += latency;
+  if (latency > this->alertLatencyMax) this->alertLatencyMax = latency;
+  DEBUG_OLEDDISPLAYUI("[OLEDDisplayUi] alert frame %d shown in %u ms\n", this->alertFrame, latency);
+}
 
 // -/----- Overlays ------\-
 void OLEDDisplayUiAux::setOverlays(OverlayCallback* overlayFunctions, uint8_t overlayCount){
   this->overlayFunctions = overlayFunctions;
   this->overlayCount     = overlayCount;
+  for (uint8_t i = 0; i < OLEDDISPLAYUI_MAX_OVERLAY_LAYERS; i++)
+    this->overlayLayers[i].valid = false;
+  this->invalidateComposite();
+}
+
+void OLEDDisplayUiAux::setOverlayLayer(uint8_t overlay, uint8_t *buffer, SurfaceOp op) {
+  if (overlay >= OLEDDISPLAYUI_MAX_OVERLAY_LAYERS) return;
+  this->overlayLayers[overlay].buffer = buffer;
+  this->overlayLayers[overlay].op = op;
+  this->overlayLayers[overlay].valid = false;
+  this->invalidateComposite();
+}
+
+void OLEDDisplayUiAux::invalidateOverlay(uint8_t overlay) {
+  if (overlay >= OLEDDISPLAYUI_MAX_OVERLAY_LAYERS) return;
+  this->overlayLayers[overlay].valid = false;
+  this->invalidateComposite();
+}
+
+bool OLEDDisplayUiAux::areOverlaysLayered() {
+  for (uint8_t i = 0; i < this->overlayCount; i++)
+    if (i >= OLEDDISPLAYUI_MAX_OVERLAY_LAYERS || !this->overlayLayers[i].buffer) return false;
+  return true;
+}
+
+void OLEDDisplayUiAux::invalidateComposite() {
+  this->compositeValid = false;
+  this->updateNow = true;
 }
 
 // -/----- Loading Process -----\-
@@ -153,6 +437,38 @@ void OLEDDisplayUiAux::runLoadingProcess(LoadingStage* stages, uint8_t stagesCou
   display->display();
 
   delay(150);
+  this->shadowValid = false;
+}
+
+// -/----- Display flush -----\-
+void OLEDDisplayUiAux::setFlushFunction(FlushCallback flushFunction) {
+  this->flushFunction = flushFunction;
+  this->shadowValid = false;
+}
+
+void OLEDDisplayUiAux::setAsyncFlush(FlushChunkCallback chunkFunction, uint8_t chunksPerUpdate, uint8_t chunkBytes) {
+  this->flushChunkFunction = chunkFunction;
+  this->flushChunksPerUpdate = chunksPerUpdate;
+  this->flushChunkBytes = chunkBytes ? chunkBytes : 1;
+  this->flushPage = DISPLAY_HEIGHT / 8;
+  this->flushDeferred = false;
+  this->shadowValid = false;
+}
+
+void OLEDDisplayUiAux::invalidateDisplay() {
+  // Rest of a draining frame is stale too
+  this->flushPage = DISPLAY_HEIGHT / 8;
+  this->flushDeferred = false;
+  this->shadowValid = false;
+  this->updateNow = true;
+}
+
+uint32_t OLEDDisplayUiAux::getFlushBytesTotal() {
+  return this->flushBytesTotal;
+}
+
+uint32_t OLEDDisplayUiAux::getFlushBytesPerSecond() {
+  return this->flushBytesPerSecond;
 }
 
 // -/----- Manuel control -----\-
@@ -160,39 +476,43 @@ void OLEDDisplayUiAux::nextFrame() {
   if (this->state.frameState != IN_TRANSITION) {
     this->state.manuelControll = true;
     this->state.frameState = IN_TRANSITION;
-    this->state.ticksSinceLastStateSwitch = 0;
+    this->restartStateTime();
     this->lastTransitionDirection = this->state.frameTransitionDirection;
     this->state.frameTransitionDirection = 1;
+    this->nextFrameNumber = this->findNextFrame(1);
   }
 }
 void OLEDDisplayUiAux::previousFrame() {
   if (this->state.frameState != IN_TRANSITION) {
     this->state.manuelControll = true;
     this->state.frameState = IN_TRANSITION;
-    this->state.ticksSinceLastStateSwitch = 0;
+    this->restartStateTime();
     this->lastTransitionDirection = this->state.frameTransitionDirection;
     this->state.frameTransitionDirection = -1;
+    this->nextFrameNumber = this->findNextFrame(-1);
   }
 }
 
 void OLEDDisplayUiAux::switchToFrame(uint8_t frame) {
-  if (frame >= this->frameCount) return;
-  this->state.ticksSinceLastStateSwitch = 0;
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES || !this->frames[frame].frameFunction) return;
+  this->restartStateTime();
   if (frame == this->state.currentFrame) return;
   this->state.frameState = FIXED;
   this->state.currentFrame = frame;
+  this->nextFrameNumber = -1;
   this->state.isIndicatorDrawen = true;
 }
 
 void OLEDDisplayUiAux::transitionToFrame(uint8_t frame) {
-  if (frame >= this->frameCount) return;
-  this->state.ticksSinceLastStateSwitch = 0;
+  if (frame >= OLEDDISPLAYUI_MAX_FRAMES || !this->frames[frame].frameFunction) return;
+  this->restartStateTime();
   if (frame == this->state.currentFrame) return;
   this->nextFrameNumber = frame;
   this->lastTransitionDirection = this->state.frameTransitionDirection;
   this->state.manuelControll = true;
   this->state.frameState = IN_TRANSITION;
-  this->state.frameTransitionDirection = frame < this->state.currentFrame ? -1 : 1;
+  this->state.frameTransitionDirection =
+    this->getRotationPosition(frame) < this->getRotationPosition(this->state.currentFrame) ? -1 : 1;
 }
 
 
@@ -202,30 +522,81 @@ OLEDDisplayUiState* OLEDDisplayUiAux::getUiState(){
 }
 
 
-int8_t OLEDDisplayUiAux::update(){
-  long frameStart = millis();
-  int8_t timeBudget = this->updateInterval - (frameStart - this->state.lastUpdate);
-  if ( timeBudget <= 0) {
-    // Implement frame skipping to ensure time budget is keept
-    if (this->autoTransition && this->state.lastUpdate != 0) this->state.ticksSinceLastStateSwitch += ceil(-timeBudget / this->updateInterval);
+int32_t OLEDDisplayUiAux::update(){
+  // Drain the previous frame, and the one composed while it was busy
+  if (this->flushChunkFunction) this->pumpFlush(this->flushChunksPerUpdate);
 
+  unsigned long frameStart = millis();
+  if (this->updateNow || (long) (frameStart - this->nextUpdate) >= 0) {
+    this->updateNow = false;
     this->state.lastUpdate = frameStart;
+    OLEDDISPLAYUI_PROFILE_BEGIN(t);
     this->tick();
+    OLEDDISPLAYUI_PROFILE_END(PROFILE_TICK, 0, t);
+    this->nextUpdate = frameStart + this->getNextUpdateInterval();
+  }
+  // Earlier update asked for by callbacks or since the last call
+  if (this->updateScheduled) {
+    if ((long) (this->scheduledUpdate - this->nextUpdate) < 0)
+      this->nextUpdate = this->scheduledUpdate;
+    this->updateScheduled = false;
+  }
+  return this->getTimeToUpdate();
+}
+
+void OLEDDisplayUiAux::scheduleUpdate(uint32_t ms) {
+  unsigned long at = millis() + ms;
+  if (!this->updateScheduled || (long) (at - this->scheduledUpdate) < 0) {
+    this->scheduledUpdate = at;
+    this->updateScheduled = true;
+  }
+}
+
+int32_t OLEDDisplayUiAux::getTimeToUpdate() {
+  if (this->updateNow) return 0;
+  return (long) (this->nextUpdate - millis());
+}
+
+uint32_t OLEDDisplayUiAux::getNextUpdateInterval() {
+  uint32_t interval = this->updateInterval;
+
+  if (this->state.frameState == IN_TRANSITION) return interval;
+
+  FrameEntry *entry = &this->frames[this->state.currentFrame];
+  if (entry->interval > 0)
+    interval = entry->interval;
+  // Not to be late for the next transition or the end of alert
+  if (this->autoTransition || this->state.currentFrame == this->alertFrame) {
+    uint32_t dwell = this->getFrameDwell(this->state.currentFrame);
+    uint32_t left = this->state.timeSinceLastStateSwitch < dwell ?
+                    dwell - this->state.timeSinceLastStateSwitch : 0;
+    if (left < interval) interval = left;
   }
-  return this->updateInterval - (millis() - frameStart);
+  return interval;
+}
+
+void OLEDDisplayUiAux::restartStateTime() {
+  this->state.stateSwitchTime = millis();
+  this->state.timeSinceLastStateSwitch = 0;
+  this->snapshotsTaken = false;
+  this->updateNow = true;
 }
 
 
 void OLEDDisplayUiAux::tick() {
-  this->state.ticksSinceLastStateSwitch++;
+  unsigned long now = millis();
+  this->state.timeSinceLastStateSwitch = now - this->state.stateSwitchTime;
 
   switch (this->state.frameState) {
     case IN_TRANSITION:
-        if (this->state.ticksSinceLastStateSwitch >= this->ticksPerTransition){
+        if (this->state.timeSinceLastStateSwitch >= this->timePerTransition){
           this->state.frameState = FIXED;
           this->state.currentFrame = getNextFrameNumber();
-          this->state.ticksSinceLastStateSwitch = 0;
+          this->state.stateSwitchTime = now;
+          this->state.timeSinceLastStateSwitch = 0;
           this->nextFrameNumber = -1;
+          // Alert raised during the transition
+          this->preemptAlert(now);
         }
       break;
     case FIXED:
@@ -234,59 +605,251 @@ void OLEDDisplayUiAux::tick() {
         this->state.frameTransitionDirection = this->lastTransitionDirection;
         this->state.manuelControll = false;
       }
-      if (this->state.ticksSinceLastStateSwitch >= this->ticksPerFrame){
-          if (this->autoTransition){
-            this->state.frameState = IN_TRANSITION;
+      // Alert done at end of hold, or when left by manual control
+      if (this->alertFrame >= 0) {
+        if (this->state.currentFrame != this->alertFrame) {
+          this->endAlert();
+        } else if (this->state.timeSinceLastStateSwitch >= this->getFrameDwell(this->alertFrame)) {
+          uint8_t returnFrame = this->alertReturnFrame;
+          this->endAlert();
+          if (this->preemptAlert(now)) {
+            // Next pending alert, then back to the same frame
+            this->alertReturnFrame = returnFrame;
+          } else {
+            // Back to rotation where it was preempted
+            uint8_t frame = returnFrame;
+            if (!this->isFrameShown(frame))
+              frame = this->findNextFrame(this->state.frameTransitionDirection);
+            if (frame != this->state.currentFrame) {
+              this->nextFrameNumber = frame;
+              this->state.frameState = IN_TRANSITION;
+              this->snapshotsTaken = false;
+            }
+            this->state.stateSwitchTime = now;
+            this->state.timeSinceLastStateSwitch = 0;
           }
-          this->state.ticksSinceLastStateSwitch = 0;
+          break;
+        }
+      }
+      if (this->preemptAlert(now)) break;
+      if (this->state.currentFrame == this->alertFrame) break;
+      {
+        uint16_t dwell = this->getFrameDwell(this->state.currentFrame);
+        // Move on at end of dwell, or at once if frame is gone or has no data
+        bool shown = this->isFrameShown(this->state.currentFrame);
+        if (this->state.timeSinceLastStateSwitch >= dwell || !shown){
+            if (this->autoTransition || !shown){
+              this->nextFrameNumber = this->findNextFrame(this->state.frameTransitionDirection);
+              if (this->nextFrameNumber != this->state.currentFrame) {
+                this->state.frameState = IN_TRANSITION;
+                this->snapshotsTaken = false;
+              } else {
+                this->nextFrameNumber = -1;
+              }
+            }
+            this->state.stateSwitchTime = now;
+            this->state.timeSinceLastStateSwitch = 0;
+        }
       }
       break;
   }
 
-  this->display->clear();
-  this->drawFrame();
-  if (shouldDrawIndicators) {
-    this->drawIndicator();
+  // Nothing to draw if FIXED frame content is the same as on the panel
+  // and so are the layers over it
+  bool frameUnchanged = this->isFrameUnchanged();
+  if (!frameUnchanged || !this->compositeValid || !this->shadowValid || !this->areOverlaysLayered()) {
+    this->drawFrame(frameUnchanged);
+    if (shouldDrawIndicators) {
+      OLEDDISPLAYUI_PROFILE_BEGIN(t);
+      this->drawIndicator();
+      OLEDDISPLAYUI_PROFILE_END(PROFILE_INDICATOR, 0, t);
+    }
+    this->drawOverlays();
+    OLEDDISPLAYUI_PROFILE_BEGIN(t);
+    this->flushDisplay();
+    OLEDDISPLAYUI_PROFILE_END(PROFILE_FLUSH, 0, t);
+    this->compositeValid = true;
   }
-  this->drawOverlays();
-  this->display->display();
+
+  // Alert frame is on the panel now, or when drained
+  if (this->alertMeasure && !this->isFlushBusy() && !this->flushDeferred) this->recordAlertLatency();
+}
+
+void OLEDDisplayUiAux::flushDisplay() {
+  uint8_t *buffer = this->display->buffer;
+  uint32_t bytes = 0;
+
+  if (this->flushChunkFunction != NULL) {
+    // shadowBuffer is what is draining: send this frame after it
+    if (this->isFlushBusy()) {
+      this->flushDeferred = true;
+      return;
+    }
+    this->flushDeferred = false;
+  }
+
+  if (this->flushFunction == NULL && this->flushChunkFunction == NULL) {
+    if (!this->shadowValid || memcmp(this->shadowBuffer, buffer, DISPLAY_BUFFER_SIZE) != 0) {
+      this->display->display();
+      memcpy(this->shadowBuffer, buffer, DISPLAY_BUFFER_SIZE);
+      bytes = DISPLAY_BUFFER_SIZE + OLEDDISPLAYUI_WINDOW_OVERHEAD;
+    }
+  } else {
+    // Send changed column range of each page
+    for (uint8_t page = 0; page < DISPLAY_HEIGHT / 8; page++) {
+      uint8_t *row = buffer + page * DISPLAY_WIDTH;
+      uint8_t *shadow = this->shadowBuffer + page * DISPLAY_WIDTH;
+      int16_t x0 = 0, x1 = DISPLAY_WIDTH - 1;
+
+      this->flushWindowX0[page] = 1;
+      this->flushWindowX1[page] = 0;
+      if (this->shadowValid) {
+        while (x0 < DISPLAY_WIDTH && row[x0] == shadow[x0]) x0++;
+        if (x0 == DISPLAY_WIDTH) continue;  // page unchanged
+        while (row[x1] == shadow[x1]) x1--;
+      }
+      memcpy(shadow + x0, row + x0, x1 - x0 + 1);
+      if (this->flushChunkFunction) {
+        this->flushWindowX0[page] = x0;
+        this->flushWindowX1[page] = x1;
+      } else {
+        (this->flushFunction)(this->display, page, x0, x1);
+      }
+      bytes += x1 - x0 + 1 + OLEDDISPLAYUI_WINDOW_OVERHEAD;
+    }
+  }
+  this->shadowValid = true;
+  if (this->flushChunkFunction) {
+    this->nextFlushPage(0);
+    this->pumpFlush(this->flushChunksPerUpdate);
+  }
+
+  this->flushBytesTotal += bytes;
+  this->flushBytesWindow += bytes;
+  unsigned long now = millis();
+  if (now - this->flushWindowStart >= 1000) {
+    this->flushBytesPerSecond = this->flushBytesWindow * 1000 / (now - this->flushWindowStart);
+    this->flushBytesWindow = 0;
+    this->flushWindowStart = now;
+    DEBUG_OLEDDISPLAYUI("[OLEDDisplayUi] flush %u bytes/s\n", this->flushBytesPerSecond);
+  }
+}
+
+// Start draining the first changed window from page on
+void OLEDDisplayUiAux::nextFlushPage(uint8_t page) {
+  while (page < DISPLAY_HEIGHT / 8 && this->flushWindowX0[page] > this->flushWindowX1[page]) page++;
+  this->flushPage = page;
+  if (page < DISPLAY_HEIGHT / 8) this->flushX = this->flushWindowX0[page];
+}
+
+bool OLEDDisplayUiAux::pumpFlush(uint8_t chunks) {
+  FlushChunk chunk;
+
+  while (this->flushPage < DISPLAY_HEIGHT / 8) {
+    uint8_t page = this->flushPage;
+    uint8_t left = this->flushWindowX1[page] - this->flushX + 1;
+
+    chunk.page = page;
+    chunk.x0 = this->flushWindowX0[page];
+    chunk.x1 = this->flushWindowX1[page];
+    chunk.x = this->flushX;
+    chunk.length = left < this->flushChunkBytes ? left : this->flushChunkBytes;
+    chunk.data = this->shadowBuffer + page * DISPLAY_WIDTH + this->flushX;
+    if (!(this->flushChunkFunction)(this->display, &chunk)) break;  // bus busy
+
+    if (chunk.length == left)
+      this->nextFlushPage(page + 1);
+    else
+      this->flushX += chunk.length;
+    if (chunks && --chunks == 0) break;
+  }
+
+  if (this->flushPage < DISPLAY_HEIGHT / 8) return true;
+  // Frame composed while draining goes out right after, not on the next
+  // update, which may be a frame interval away
+  if (this->flushDeferred) {
+    this->flushDisplay();
+    return this->isFlushBusy();
+  }
+  if (this->alertMeasure) this->recordAlertLatency();
+  return false;
+}
+
+bool OLEDDisplayUiAux::isFlushBusy() {
+  return this->flushPage < DISPLAY_HEIGHT / 8;
+}
+
+bool OLEDDisplayUiAux::isFrameUnchanged() {
+  uint8_t frame = this->state.currentFrame;
+  bool fixed = this->state.frameState == FIXED;
+  VersionCallback versionFunction = NULL;
+  WidgetScreen *screen = NULL;
+  uint32_t version = 0;
+
+  if (fixed) {
+    versionFunction = this->frames[frame].versionFunction;
+    screen = this->frames[frame].screen;
+  }
+  if (screen)
+    version = screen->poll();
+  else if (versionFunction)
+    version = (versionFunction)(this->getRotationPosition(frame), this->frameCount);
+
+  bool unchanged = (versionFunction != NULL || screen != NULL) && this->frameLayerFrame == frame &&
+                   this->lastDrawnFixed && this->lastDrawnFrame == frame && this->lastDrawnVersion == version;
+
+  this->lastDrawnFixed = fixed;
+  this->lastDrawnFrame = frame;
+  this->lastDrawnVersion = version;
+  return unchanged;
 }
 
 void OLEDDisplayUiAux::resetState() {
+  this->lastDrawnFixed = false;
   this->state.lastUpdate = 0;
-  this->state.ticksSinceLastStateSwitch = 0;
+  this->restartStateTime();
   this->state.frameState = FIXED;
-  this->state.currentFrame = 0;
+  this->state.currentFrame = this->frameCount ? this->rotation[0] : 0;
+  this->nextFrameNumber = -1;
+  this->frameLayerFrame = -1;
   this->state.isIndicatorDrawen = true;
 }
 
-void OLEDDisplayUiAux::drawFrame(){
+void OLEDDisplayUiAux::drawFrame(bool frameUnchanged){
+  if (this->frameCount == 0) {
+    this->display->clear();
+    return;
+  }
+
   switch (this->state.frameState){
      case IN_TRANSITION: {
-       float progress = (float) this->state.ticksSinceLastStateSwitch / (float) this->ticksPerTransition;
+       this->display->clear();
+
+       // Slide positions in integer: trunc(128 * progress)
+       int32_t progress = this->getTransitionProgress();
        int16_t x, y, x1, y1;
        switch(this->frameAnimationDirection){
         case SLIDE_LEFT:
-          x = -128 * progress;
+          x = -((DISPLAY_WIDTH * progress) >> 16);
           y = 0;
           x1 = x + 128;
           y1 = 0;
           break;
         case SLIDE_RIGHT:
-          x = 128 * progress;
+          x = (DISPLAY_WIDTH * progress) >> 16;
           y = 0;
           x1 = x - 128;
           y1 = 0;
           break;
         case SLIDE_UP:
           x = 0;
-          y = -64 * progress;
+          y = -((DISPLAY_HEIGHT * progress) >> 16);
           x1 = 0;
           y1 = y + 64;
           break;
         case SLIDE_DOWN:
           x = 0;
-          y = 64 * progress;
+          y = (DISPLAY_HEIGHT * progress) >> 16;
           x1 = 0;
           y1 = y - 64;
           break;
@@ -296,18 +859,29 @@ void OLEDDisplayUiAux::drawFrame(){
        int8_t dir = this->state.frameTransitionDirection >= 0 ? 1 : -1;
        x *= dir; y *= dir; x1 *= dir; y1 *= dir;
 
-       bool drawenCurrentFrame;
-
+       uint8_t ids[2] = { this->state.currentFrame, this->getNextFrameNumber() };
+       int16_t xs[2] = { x, x1 };
+       int16_t ys[2] = { y, y1 };
+       bool drawen[2];
 
-       // Prope each frameFunction for the indicator Drawen state
-       this->enableIndicator();
-       (this->frameFunctions[this->state.currentFrame])(this->display, &this->state, x, y);
-       drawenCurrentFrame = this->state.isIndicatorDrawen;
+       if (!this->snapshotsTaken) this->takeSnapshots();
 
-       this->enableIndicator();
-       (this->frameFunctions[this->getNextFrameNumber()])(this->display, &this->state, x1, y1);
-       if (this->auxCount)
-         (this->auxFunctions[this->getNextFrameNumber() % this->auxCount])(this->getNextFrameNumber(), this->frameCount);
+       for (uint8_t i = 0; i < 2; i++) {
+         if (this->isLiveFrame(ids[i])) {
+           // Prope each frameFunction for the indicator Drawen state
+           this->enableIndicator();
+           OLEDDISPLAYUI_PROFILE_BEGIN(t);
+           this->callFrame(ids[i], xs[i], ys[i]);
+           OLEDDISPLAYUI_PROFILE_END(PROFILE_FRAME, ids[i], t);
+           drawen[i] = this->state.isIndicatorDrawen;
+         } else {
+           Surface snapshot(this->snapshotBuffer[i], DISPLAY_WIDTH, DISPLAY_HEIGHT / 8);
+           snapshot.blitTo(this->display, xs[i], ys[i], 0, DISPLAY_WIDTH);
+           drawen[i] = this->snapshotIndicatorDrawen[i];
+         }
+       }
+       bool drawenCurrentFrame = drawen[0];
+       this->state.isIndicatorDrawen = drawen[1];
 
        // Build up the indicatorDrawState
        if (drawenCurrentFrame && !this->state.isIndicatorDrawen) {
@@ -331,14 +905,84 @@ void OLEDDisplayUiAux::drawFrame(){
       // Always assume that the indicator is drawn!
       // And set indicatorDrawState to "not known yet"
       this->indicatorDrawState = 0;
-      this->enableIndicator();
-      (this->frameFunctions[this->state.currentFrame])(this->display, &this->state, 0, 0);
-      if (this->auxCount)
-        (this->auxFunctions[this->state.currentFrame % this->auxCount])(this->state.currentFrame, this->frameCount);
+      // Frame layer is drawn only when content changed, then copied under the other layers
+      if (!frameUnchanged) {
+        this->renderFrame(this->snapshotBuffer[0], this->state.currentFrame);
+        this->snapshotIndicatorDrawen[0] = this->state.isIndicatorDrawen;
+        this->frameLayerFrame = this->state.currentFrame;
+        this->callAux(this->state.currentFrame);
+      }
+      this->state.isIndicatorDrawen = this->snapshotIndicatorDrawen[0];
+      memcpy(this->display->buffer, this->snapshotBuffer[0], DISPLAY_BUFFER_SIZE);
       break;
   }
 }
 
+// Q16.16 progress of the transition, eased
+int32_t OLEDDisplayUiAux::getTransitionProgress() {
+  uint32_t elapsed = this->state.timeSinceLastStateSwitch;
+  uint32_t progress = (uint32_t) 1 << 16;
+  const int16_t *curve;
+
+  // elapsed < timePerTransition <= 65535, so elapsed << 16 fits
+  if (elapsed < this->timePerTransition)
+    progress = (elapsed << 16) / this->timePerTransition;
+
+  switch (this->transitionEasing) {
+    case EASE_IN_OUT:    curve = EASING_IN_OUT; break;
+    case EASE_OVERSHOOT: curve = EASING_OVERSHOOT; break;
+    default:             return progress;  // linear: exact
+  }
+
+  // Interpolate curve points 1/64 apart: 10 bits of fraction
+  uint8_t i = progress >> 10;
+  int32_t p0 = (int16_t) pgm_read_word(&curve[i]);
+  if (i >= 64) return p0 << 8;
+  int32_t p1 = (int16_t) pgm_read_word(&curve[i + 1]);
+  return (p0 << 8) + (((p1 - p0) * (int32_t) (progress & 1023)) >> 2);
+}
+
+// Render frame at rest position into buffer by pointing display to it
+void OLEDDisplayUiAux::renderFrame(uint8_t *buffer, uint8_t frame) {
+  uint8_t *displayBuffer = this->display->buffer;
+  WidgetScreen *screen = this->frames[frame].screen;
+
+  this->enableIndicator();
+  this->display->buffer = buffer;
+  OLEDDISPLAYUI_PROFILE_BEGIN(t);
+  if (screen && buffer == this->snapshotBuffer[0] && this->frameLayerFrame == frame) {
+    // Frame layer holds the screen as drawn: redraw its changed widgets
+    screen->update(this->display);
+  } else {
+    this->display->clear();
+    this->callFrame(frame, 0, 0);
+  }
+  OLEDDISPLAYUI_PROFILE_END(PROFILE_FRAME, frame, t);
+  this->display->buffer = displayBuffer;
+}
+
+void OLEDDisplayUiAux::callFrame(uint8_t frame, int16_t x, int16_t y) {
+  if (this->frames[frame].screen)
+    this->frames[frame].screen->draw(this->display, x, y);
+  else
+    (this->frames[frame].frameFunction)(this->display, &this->state, x, y);
+}
+
+void OLEDDisplayUiAux::takeSnapshots() {
+  uint8_t ids[2] = { this->state.currentFrame, this->getNextFrameNumber() };
+
+  for (uint8_t i = 0; i < 2; i++) {
+    if (this->isLiveFrame(ids[i])) continue;
+    // Current frame is in the frame layer already, as on the panel
+    if (i == 0 && this->frameLayerFrame == ids[0]) continue;
+    this->renderFrame(this->snapshotBuffer[i], ids[i]);
+    this->snapshotIndicatorDrawen[i] = this->state.isIndicatorDrawen;
+    if (i == 0) this->frameLayerFrame = ids[0];
+  }
+  this->callAux(ids[1]);
+  this->snapshotsTaken = true;
+}
+
 void OLEDDisplayUiAux::drawIndicator() {
 
     // Only draw if the indicator is invisible
@@ -349,7 +993,7 @@ void OLEDDisplayUiAux::drawIndicator() {
     }
 
     uint8_t posOfHighlightFrame;
-    float indicatorFadeProgress = 0;
+    int16_t indicatorFade = 0;  // 0 ~ 8 px slided out
 
     // if the indicator needs to be slided in we want to
     // highlight the next frame in the transition
@@ -359,65 +1003,179 @@ void OLEDDisplayUiAux::drawIndicator() {
     // based on the Direction the indiactor is drawn
     switch (this->indicatorDirection){
       case LEFT_RIGHT:
-        posOfHighlightFrame = frameToHighlight;
+        posOfHighlightFrame = this->getRotationPosition(frameToHighlight);
         break;
       case RIGHT_LEFT:
-        posOfHighlightFrame = this->frameCount - frameToHighlight;
+        posOfHighlightFrame = this->frameCount - this->getRotationPosition(frameToHighlight);
         break;
     }
 
     switch (this->indicatorDrawState) {
       case 1: // Indicator was not drawn in this frame but will be in next
         // Slide IN
-        indicatorFadeProgress = 1 - ((float) this->state.ticksSinceLastStateSwitch / (float) this->ticksPerTransition);
+        if (this->state.timeSinceLastStateSwitch < this->timePerTransition)
+          indicatorFade = 8 * (this->timePerTransition - this->state.timeSinceLastStateSwitch) / this->timePerTransition;
         break;
       case 2: // Indicator was drawn in this frame but not in next
         // Slide OUT
-        indicatorFadeProgress = ((float) this->state.ticksSinceLastStateSwitch / (float) this->ticksPerTransition);
+        indicatorFade = this->state.timeSinceLastStateSwitch < this->timePerTransition ?
+                        8 * this->state.timeSinceLastStateSwitch / this->timePerTransition : 8;
         break;
     }
 
-    uint16_t frameStartPos = (12 * frameCount / 2);
-    const char *image;
-    uint16_t x,y;
-    for (byte i = 0; i < this->frameCount; i++) {
-
-      switch (this->indicatorPosition){
-        case TOP:
-          y = 0 - (8 * indicatorFadeProgress);
-          x = 64 - frameStartPos + 12 * i;
-          break;
-        case BOTTOM:
-          y = 56 + (8 * indicatorFadeProgress);
-          x = 64 - frameStartPos + 12 * i;
-          break;
-        case RIGHT:
-          x = 120 + (8 * indicatorFadeProgress);
-          y = 32 - frameStartPos + 2 + 12 * i;
-          break;
-        case LEFT:
-          x = 0 - (8 * indicatorFadeProgress);
-          y = 32 - frameStartPos + 2 + 12 * i;
-          break;
-      }
+    // Symbols are drawn into the indicator layer when highlight changes,
+    // the fade is where the layer is blitted
+    bool horizontal = this->indicatorPosition == TOP || this->indicatorPosition == BOTTOM;
+    Surface layer(this->indicatorBuffer, horizontal ? DISPLAY_WIDTH : 8, horizontal ? 1 : DISPLAY_HEIGHT / 8);
 
-      if (posOfHighlightFrame == i) {
-         image = this->activeSymbol;
-      } else {
-         image = this->inactiveSymbol;
+    if (!this->indicatorLayerValid || this->indicatorLayerHighlight != posOfHighlightFrame ||
+        this->indicatorLayerCount != this->frameCount) {
+      int16_t frameStartPos = (12 * frameCount / 2);
+      layer.clear();
+      for (byte i = 0; i < this->frameCount; i++) {
+        const char *image = posOfHighlightFrame == i ? this->activeSymbol : this->inactiveSymbol;
+        if (horizontal)
+          layer.drawImage(64 - frameStartPos + 12 * i, 0, 8, 8, image);
+        else
+          layer.drawImage(0, 32 - frameStartPos + 2 + 12 * i, 8, 8, image);
       }
+      this->indicatorLayerValid = true;
+      this->indicatorLayerHighlight = posOfHighlightFrame;
+      this->indicatorLayerCount = this->frameCount;
+    }
 
-      this->display->drawFastImage(x, y, 8, 8, image);
+    switch (this->indicatorPosition){
+      case TOP:
+        layer.blitTo(this->display, 0, 0 - indicatorFade, 0, layer.width);
+        break;
+      case BOTTOM:
+        layer.blitTo(this->display, 0, 56 + indicatorFade, 0, layer.width);
+        break;
+      case RIGHT:
+        layer.blitTo(this->display, 120 + indicatorFade, 0, 0, layer.width);
+        break;
+      case LEFT:
+        layer.blitTo(this->display, 0 - indicatorFade, 0, 0, layer.width);
+        break;
     }
 }
 
 void OLEDDisplayUiAux::drawOverlays() {
+ uint8_t *displayBuffer = this->display->buffer;
+
  for (uint8_t i=0;i<this->overlayCount;i++){
-    (this->overlayFunctions[i])(this->display, &this->state);
+    OverlayLayer *layer = i < OLEDDISPLAYUI_MAX_OVERLAY_LAYERS ? &this->overlayLayers[i] : NULL;
+    bool direct = layer == NULL || layer->buffer == NULL;
+
+    if (direct || !layer->valid) {
+      // Draw into layer by pointing display to it
+      if (!direct) {
+        this->display->buffer = layer->buffer;
+        this->display->clear();
+      }
+      OLEDDISPLAYUI_PROFILE_BEGIN(t);
+      (this->overlayFunctions[i])(this->display, &this->state);
+      OLEDDISPLAYUI_PROFILE_END(PROFILE_OVERLAY, i, t);
+      this->display->buffer = displayBuffer;
+      if (direct) continue;
+      layer->valid = true;
+    }
+    Surface surface(layer->buffer, DISPLAY_WIDTH, DISPLAY_HEIGHT / 8);
+    surface.blitTo(this->display, 0, 0, 0, DISPLAY_WIDTH, layer->op);
  }
 }
 
 uint8_t OLEDDisplayUiAux::getNextFrameNumber(){
   if (this->nextFrameNumber != -1) return this->nextFrameNumber;
-  return (this->state.currentFrame + this->frameCount + this->state.frameTransitionDirection) % this->frameCount;
+  return this->findNextFrame(this->state.frameTransitionDirection);
+}
+
+#ifdef OLEDDISPLAYUI_PROFILE
+// -/----- Profiling -----\-
+void OLEDDisplayUiAux::profileRecord(UiProfileKind kind, uint8_t index, uint32_t time) {
+  UiProfileStat *stat;
+
+  switch (kind) {
+    case PROFILE_TICK:      stat = &this->profile.tick; break;
+    case PROFILE_FLUSH:     stat = &this->profile.flush; break;
+    case PROFILE_INDICATOR: stat = &this->profile.indicator; break;
+    case PROFILE_FRAME:
+      if (index >= OLEDDISPLAYUI_PROFILE_FRAMES) return;
+      stat = &this->profile.frames[index];
+      break;
+    case PROFILE_AUX:
+      if (index >= OLEDDISPLAYUI_PROFILE_FRAMES) return;
+      stat = &this->profile.auxes[index];
+      break;
+    case PROFILE_OVERLAY:
+      if (index >= OLEDDISPLAYUI_PROFILE_OVERLAYS) return;
+      stat = &this->profile.overlays[index];
+      break;
+    default:
+      return;
+  }
+
+  if (stat->count == 0 || time < stat->minTime) stat->minTime = time;
+  if (time > stat->maxTime) stat->maxTime = time;
+  stat->count++;
+  stat->totalTime += time;
+  if (time > (uint32_t) this->updateInterval * 1000) stat->overruns++;
+
+  uint8_t bucket = time > 1 ? 31 - __builtin_clz(time) : 0;
+  if (bucket >= OLEDDISPLAYUI_PROFILE_BUCKETS) bucket = OLEDDISPLAYUI_PROFILE_BUCKETS - 1;
+  if (stat->histogram[bucket] < 0xffff) stat->histogram[bucket]++;
+}
+
+UiProfile* OLEDDisplayUiAux::getProfile() {
+  return &this->profile;
+}
+
+void OLEDDisplayUiAux::resetProfile() {
+  memset(&this->profile, 0, sizeof(this->profile));
+}
+
+uint32_t OLEDDisplayUiAux::getProfilePercentile(const UiProfileStat *stat, uint8_t percent) {
+  uint32_t total = 0, sum = 0;
+  uint8_t i;
+
+  for (i = 0; i < OLEDDISPLAYUI_PROFILE_BUCKETS; i++)
+    total += stat->histogram[i];
+  if (total == 0) return 0;
+
+  for (i = 0; i < OLEDDISPLAYUI_PROFILE_BUCKETS - 1; i++) {
+    sum += stat->histogram[i];
+    if (sum * 100 >= total * percent) break;
+  }
+  // Upper bound of bucket, but no more than seen
+  uint32_t bound = ((uint32_t) 2 << i) - 1;
+  return bound < stat->maxTime ? bound : stat->maxTime;
+}
+
+static void printProfileStat(Print *out, const char *name, int index, const UiProfileStat *stat) {
+  if (stat->count == 0) return;
+  char label[16];
+  if (index >= 0) snprintf(label, sizeof(label), "%s %d", name, index);
+  else            snprintf(label, sizeof(label), "%s", name);
+  out->printf("%-12s %8u %7u %7u %7u %7u %7u\n", label, stat->count, stat->minTime,
+              (uint32_t) (stat->totalTime / stat->count), stat->maxTime,
+              OLEDDisplayUiAux::getProfilePercentile(stat, 99), stat->overruns);
+}
+
+void OLEDDisplayUiAux::printProfile(Print *out) {
+  uint8_t i;
+
+  out->printf("%-12s %8s %7s %7s %7s %7s %7s\n", "[us]", "count", "min", "avg", "max", "p99", "overrun");
+  printProfileStat(out, "tick", -1, &this->profile.tick);
+  printProfileStat(out, "flush", -1, &this->profile.flush);
+  printProfileStat(out, "indicator", -1, &this->profile.indicator);
+  for (i = 0; i < OLEDDISPLAYUI_PROFILE_FRAMES; i++)
+    printProfileStat(out, "frame", i, &this->profile.frames[i]);
+  for (i = 0; i < OLEDDISPLAYUI_PROFILE_FRAMES; i++)
+    printProfileStat(out, "aux", i, &this->profile.auxes[i]);
+  for (i = 0; i < OLEDDISPLAYUI_PROFILE_OVERLAYS; i++)
+    printProfileStat(out, "overlay", i, &this->profile.overlays[i]);
+  if (this->alertCount)
+    out->printf("alert latency [ms] count %u last %u avg %u max %u\n", this->alertCount,
+                this->alertLatencyLast, this->getAlertLatencyAverage(), this->alertLatencyMax);
 }
+#endif
@@ -37,6 +37,7 @@
 
 #include <Arduino.h>
 #include "OLEDDisplay.h"
+#include "Surface.h"
 
 //#define DEBUG_OLEDDISPLAYUI(...) Serial.printf( __VA_ARGS__ )
 
@@ -44,6 +45,26 @@
 #define DEBUG_OLEDDISPLAYUI(...)
 #endif
 
+// Time each callback and flush in tick(), see getProfile() and printProfile()
+//#define OLEDDISPLAYUI_PROFILE
+
+#ifdef OLEDDISPLAYUI_PROFILE
+#define OLEDDISPLAYUI_PROFILE_BEGIN(t)               uint32_t t = micros()
+#define OLEDDISPLAYUI_PROFILE_END(kind, index, t)    this->profileRecord(kind, index, micros() - (t))
+#else
+#define OLEDDISPLAYUI_PROFILE_BEGIN(t)
+#define OLEDDISPLAYUI_PROFILE_END(kind, index, t)
+#endif
+
+// Frames registered at once
+#define OLEDDISPLAYUI_MAX_FRAMES 12
+
+// Overlays that can be drawn into a layer, see setOverlayLayer()
+#define OLEDDISPLAYUI_MAX_OVERLAY_LAYERS 4
+
+// Command bytes sent per page window besides data: COLUMNADDR, PAGEADDR and their args
+#define OLEDDISPLAYUI_WINDOW_OVERHEAD 6
+
 enum AnimationDirection {
   SLIDE_UP,
   SLIDE_DOWN,
@@ -51,6 +72,13 @@ enum AnimationDirection {
   SLIDE_RIGHT
 };
 
+// Curve of slide position over transition time
+enum TransitionEasing {
+  EASE_LINEAR,
+  EASE_IN_OUT,
+  EASE_OVERSHOOT
+};
+
 enum IndicatorPosition {
   TOP,
   RIGHT,
@@ -78,10 +106,46 @@ const char ANIMATION_inactiveSymbol[] PROGMEM = {
 };
 
 
+#ifdef OLEDDISPLAYUI_PROFILE
+#define OLEDDISPLAYUI_PROFILE_FRAMES    8   // frames and auxes profiled
+#define OLEDDISPLAYUI_PROFILE_OVERLAYS  4
+#define OLEDDISPLAYUI_PROFILE_BUCKETS   16  // bucket i: 2^i ~ 2^(i+1)-1 us, bucket 0 from 0
+
+enum UiProfileKind {
+  PROFILE_TICK,
+  PROFILE_FLUSH,
+  PROFILE_INDICATOR,
+  PROFILE_FRAME,
+  PROFILE_AUX,
+  PROFILE_OVERLAY
+};
+
+// Call times of one callback in us
+struct UiProfileStat {
+  uint32_t      count;
+  uint32_t      minTime;
+  uint32_t      maxTime;
+  uint64_t      totalTime;
+  uint32_t      overruns;     // calls longer than the update interval
+  uint16_t      histogram[OLEDDISPLAYUI_PROFILE_BUCKETS];
+};
+
+struct UiProfile {
+  UiProfileStat tick;         // whole tick including all below
+  UiProfileStat flush;
+  UiProfileStat indicator;
+  UiProfileStat frames[OLEDDISPLAYUI_PROFILE_FRAMES];
+  UiProfileStat auxes[OLEDDISPLAYUI_PROFILE_FRAMES];
+  UiProfileStat overlays[OLEDDISPLAYUI_PROFILE_OVERLAYS];
+};
+#endif
+
 // Structure of the UiState
 struct OLEDDisplayUiState {
   uint64_t     lastUpdate                = 0;
-  uint16_t      ticksSinceLastStateSwitch = 0;
+  // millis() when frameState was last switched, and time since then
+  unsigned long stateSwitchTime           = 0;
+  uint32_t      timeSinceLastStateSwitch  = 0;
 
   FrameState    frameState                = FIXED;
   uint8_t       currentFrame              = 0;
@@ -104,9 +168,51 @@ struct LoadingStage {
 
 typedef void (*FrameCallback)(OLEDDisplay *display,  OLEDDisplayUiState* state, int16_t x, int16_t y);
 typedef void (*AuxCallback)(int frameIndex, int frameCount);
+typedef uint32_t (*VersionCallback)(int frameIndex, int frameCount);
+typedef bool (*ReadyCallback)(int frameIndex, int frameCount);
 typedef void (*OverlayCallback)(OLEDDisplay *display,  OLEDDisplayUiState* state);
+typedef void (*FlushCallback)(OLEDDisplay *display, uint8_t page, uint8_t x0, uint8_t x1);
+
+// Part of a page window sent by the asynchronous flush
+struct FlushChunk {
+  uint8_t         page;
+  uint8_t         x0, x1;                   // window columns, to be set on the panel when x == x0
+  uint8_t         x;                        // column of data[0]
+  uint8_t         length;
+  const uint8_t   *data;
+};
+// Send or queue a chunk; false if the bus is busy, to be offered again later
+typedef bool (*FlushChunkCallback)(OLEDDisplay *display, const FlushChunk *chunk);
 typedef void (*LoadingDrawFunction)(OLEDDisplay *display, LoadingStage* stage, uint8_t progress);
 
+class WidgetScreen;
+
+// Registered frame, id is its index in the registry
+struct FrameEntry {
+  FrameCallback   frameFunction   = NULL;   // NULL for free entry
+  WidgetScreen    *screen         = NULL;   // drawn instead of frameFunction if set
+  AuxCallback     auxFunction     = NULL;
+  VersionCallback versionFunction = NULL;   // NULL to redraw always
+  ReadyCallback   readyFunction   = NULL;   // NULL if data is always there
+  uint16_t        dwell           = 0;      // ms FIXED, 0 for time per frame
+  uint16_t        interval        = 0;      // ms between updates while FIXED, 0 for target FPS
+  uint8_t         priority        = 0;      // larger comes earlier in rotation
+  bool            enabled         = true;
+  bool            live            = false;  // drawn on each transition tick, not slided snapshot
+  // Raised alert, shown before rotation
+  uint8_t         alertPriority   = 0;      // 0 for no alert
+  uint16_t        alertHold       = 0;      // ms shown
+  unsigned long   alertTime       = 0;      // millis() when raised
+  bool            alertShown      = false;  // latency recorded
+};
+
+// Overlay rendered once into its surface, then composited each update
+struct OverlayLayer {
+  uint8_t         *buffer         = NULL;   // DISPLAY_BUFFER_SIZE bytes, NULL to draw directly
+  SurfaceOp       op              = SURFACE_OR;
+  bool            valid           = false;  // buffer has overlay content
+};
+
 class OLEDDisplayUiAux {
   private:
     OLEDDisplay             *display;
@@ -122,26 +228,61 @@ class OLEDDisplayUiAux {
 
     // Values for the Frames
     AnimationDirection  frameAnimationDirection   = SLIDE_RIGHT;
+    TransitionEasing    transitionEasing          = EASE_LINEAR;
 
     int8_t              lastTransitionDirection   = 1;
 
-    uint16_t            ticksPerFrame             = 151; // ~ 5000ms at 30 FPS
-    uint16_t            ticksPerTransition        = 15;  // ~  500ms at 30 FPS
+    uint16_t            timePerFrame              = 5000; // ms
+    uint16_t            timePerTransition         = 500;  // ms
 
     bool                autoTransition            = true;
 
-    FrameCallback*      frameFunctions;
+    // Frame registry; rotation has ids of registered frames in order
+    FrameEntry          frames[OLEDDISPLAYUI_MAX_FRAMES];
+    uint8_t             rotation[OLEDDISPLAYUI_MAX_FRAMES];
     uint8_t             frameCount                = 0;
 
-    AuxCallback*        auxFunctions;
-    uint8_t             auxCount                  = 0;
+    // Last drawn FIXED frame and its content version
+    bool                lastDrawnFixed            = false;
+    uint8_t             lastDrawnFrame            = 0;
+    uint32_t            lastDrawnVersion          = 0;
+
+    // Frames rendered once at transition start, then slided by blits
+    uint8_t             snapshotBuffer[2][DISPLAY_BUFFER_SIZE];
+    bool                snapshotIndicatorDrawen[2];
+    bool                snapshotsTaken            = false;
 
     // Internally used to transition to a specific frame
     int8_t              nextFrameNumber           = -1;
 
+    // Frame shown by alert, and frame to return to after its hold
+    int8_t              alertFrame                = -1;
+    uint8_t             alertReturnFrame          = 0;
+    bool                alertMeasure              = false;
+
+    // Alert latency from raise to flush in ms
+    uint32_t            alertCount                = 0;
+    uint32_t            alertLatencyLast          = 0;
+    uint32_t            alertLatencyMax           = 0;
+    uint32_t            alertLatencyTotal         = 0;
+
     // Values for Overlays
     OverlayCallback*    overlayFunctions;
     uint8_t             overlayCount              = 0;
+    OverlayLayer        overlayLayers[OLEDDISPLAYUI_MAX_OVERLAY_LAYERS];
+
+    // Indicator symbols of all frames, rendered when highlight changes
+    // and blitted at fade position: a row for TOP/BOTTOM, a column for LEFT/RIGHT
+    uint8_t             indicatorBuffer[DISPLAY_WIDTH];
+    bool                indicatorLayerValid       = false;
+    uint8_t             indicatorLayerHighlight   = 0;
+    uint8_t             indicatorLayerCount       = 0;
+
+    // Frame layer: frame id rendered at rest in snapshotBuffer[0] while FIXED, -1 if none
+    int8_t              frameLayerFrame           = -1;
+
+    // Indicator or overlay layer changed since the last composite
+    bool                compositeValid            = false;
 
     // Will the Indicator be drawen
     // 3 Not drawn in both frames
@@ -161,13 +302,65 @@ class OLEDDisplayUiAux {
     // UI State
     OLEDDisplayUiState      state;
 
+    // Copy of what is on the panel, to flush changed page windows only
+    uint8_t             shadowBuffer[DISPLAY_BUFFER_SIZE];
+    bool                shadowValid               = false;
+    FlushCallback       flushFunction             = NULL;
+
+    // Asynchronous flush: changed windows are copied to shadowBuffer, which
+    // then drains in chunks while the next frame renders into the display buffer
+    FlushChunkCallback  flushChunkFunction        = NULL;
+    uint8_t             flushChunkBytes           = 16;
+    uint8_t             flushChunksPerUpdate      = 4;
+    uint8_t             flushWindowX0[DISPLAY_HEIGHT / 8];
+    uint8_t             flushWindowX1[DISPLAY_HEIGHT / 8];   // < x0 for page unchanged
+    uint8_t             flushPage                 = DISPLAY_HEIGHT / 8;  // page draining, or idle
+    uint8_t             flushX                    = 0;
+    bool                flushDeferred             = false;  // frame composed while busy, to be sent
+
+    // Flush statistics
+    uint32_t            flushBytesTotal           = 0;
+    uint32_t            flushBytesWindow          = 0;
+    uint32_t            flushBytesPerSecond       = 0;
+    unsigned long       flushWindowStart          = 0;
+
+#ifdef OLEDDISPLAYUI_PROFILE
+    UiProfile           profile;
+    void                profileRecord(UiProfileKind kind, uint8_t index, uint32_t time);
+#endif
+
     // Bookeeping for update
     uint8_t             updateInterval            = 33;
+    unsigned long       nextUpdate                = 0;
+    bool                updateNow                 = true;
+    bool                updateScheduled           = false;
+    unsigned long       scheduledUpdate           = 0;
 
     uint8_t             getNextFrameNumber();
+    int8_t              findNextFrame(int8_t dir);
+    int8_t              getRotationPosition(uint8_t id);
+    bool                isFrameShown(uint8_t id);
+    void                sortRotation();
+    void                callAux(uint8_t id);
+    uint16_t            getFrameDwell(uint8_t id);
+    bool                preemptAlert(unsigned long now);
+    void                endAlert();
+    void                recordAlertLatency();
     void                drawIndicator();
-    void                drawFrame();
+    void                drawFrame(bool frameUnchanged);
+    void                callFrame(uint8_t frame, int16_t x, int16_t y);
+    void                renderFrame(uint8_t *buffer, uint8_t frame);
+    bool                areOverlaysLayered();
+    void                invalidateComposite();
+    void                takeSnapshots();
+    bool                isLiveFrame(uint8_t frame);
     void                drawOverlays();
+    void                flushDisplay();
+    void                nextFlushPage(uint8_t page);
+    bool                isFrameUnchanged();
+    uint32_t            getNextUpdateInterval();
+    int32_t             getTransitionProgress();
+    void                restartStateTime();
     void                tick();
     void                resetState();
 
@@ -181,7 +374,7 @@ class OLEDDisplayUiAux {
     void init();
 
     /**
-     * Configure the internal used target FPS
+     * Configure the internal used target FPS, used in transitions
      */
     void setTargetFPS(uint8_t fps);
 
@@ -203,12 +396,12 @@ class OLEDDisplayUiAux {
     void setAutoTransitionBackwards();
 
     /**
-     *  Set the approx. time a frame is displayed
+     *  Set the time a frame is displayed in ms
      */
     void setTimePerFrame(uint16_t time);
 
     /**
-     * Set the approx. time a transition will take
+     * Set the time a transition will take in ms
      */
     void setTimePerTransition(uint16_t time);
 
@@ -268,14 +461,74 @@ class OLEDDisplayUiAux {
     void setFrameAnimation(AnimationDirection dir);
 
     /**
-     * Add frame drawing functions
+     * Configure the easing curve of transitions, used from the next tick
+     */
+    void setTransitionEasing(TransitionEasing easing);
+
+    // Frame registry
+
+    /**
+     * Register a frame; returns its id for the functions below taking a
+     * frame, or -1 if OLEDDISPLAYUI_MAX_FRAMES frames are registered.
+     * Frames rotate in order of priority, then of id.
+     */
+    int8_t addFrame(FrameCallback frameFunction, AuxCallback auxFunction = NULL, uint8_t priority = 0);
+
+    /**
+     * Register a widget screen as frame. Its widgets changed since the
+     * last draw are redrawn only, and poll() of the screen is the frame
+     * version, so no version function is needed.
+     */
+    int8_t addFrame(WidgetScreen *screen, AuxCallback auxFunction = NULL, uint8_t priority = 0);
+    void removeFrame(uint8_t frame);
+
+    /**
+     * Disabled frames, and frames whose ready function says no data,
+     * are skipped in rotation
+     */
+    void setFrameEnabled(uint8_t frame, bool enabled);
+    void setFrameReady(uint8_t frame, ReadyCallback readyFunction);
+
+    void setFrameAux(uint8_t frame, AuxCallback auxFunction);
+    void setFramePriority(uint8_t frame, uint8_t priority);
+
+    /**
+     * Set time frame is displayed in ms, 0 for `setTimePerFrame` time
+     */
+    void setFrameDwell(uint8_t frame, uint16_t time);
+
+    /**
+     * Set content version function, NULL for frame always redrawn.
+     * While a frame is FIXED and its version does not change, the frame is
+     * not drawn again, and the whole update is skipped when nothing else
+     * changed; not when overlays drawn without layer are set.
+     */
+    void setFrameVersion(uint8_t frame, VersionCallback versionFunction);
+
+    /**
+     * Set update interval in ms while frame is FIXED, 0 for target FPS.
+     * Transitions always run at the target FPS.
+     */
+    void setFrameInterval(uint8_t frame, uint16_t interval);
+
+    /**
+     * Frames are rendered once when a transition starts and then slided.
+     * A live frame is drawn on each transition tick instead,
+     * for content that changes during the transition like a clock.
+     */
+    void setLiveFrame(uint8_t frame, bool live);
+
+    /**
+     * Replace registry with frames of id 0 ~ frameCount-1
      */
     void setFrames(FrameCallback* frameFunctions, uint8_t frameCount);
 
     /**
-     * Add aux functions per frame
+     * Set aux, version and interval of frames 0 ~ count-1 by arrays
      */
     void setAuxes(AuxCallback* auxFunctions, uint8_t auxCount);
+    void setVersions(VersionCallback* versionFunctions, uint8_t versionCount);
+    void setFrameIntervals(uint16_t* frameIntervals, uint8_t frameIntervalCount);
 
     // Overlay
 
@@ -284,6 +537,16 @@ class OLEDDisplayUiAux {
      */
     void setOverlays(OverlayCallback* overlayFunctions, uint8_t overlayCount);
 
+    /**
+     * Draw overlay `overlay` once into `buffer` of DISPLAY_BUFFER_SIZE bytes,
+     * and combine it onto frames by `op` on each update: SURFACE_OR to draw,
+     * SURFACE_AND_NOT to mask out, SURFACE_XOR to invert.
+     * The overlay is drawn again only after invalidateOverlay().
+     * Overlays without layer are drawn directly on each update.
+     */
+    void setOverlayLayer(uint8_t overlay, uint8_t *buffer, SurfaceOp op = SURFACE_OR);
+    void invalidateOverlay(uint8_t overlay);
+
 
     // Loading animation
     /**
@@ -299,6 +562,42 @@ class OLEDDisplayUiAux {
     void runLoadingProcess(LoadingStage* stages, uint8_t stagesCount);
 
 
+    // Display flush
+    /**
+     * Set the function that sends columns x0..x1 of a page to the panel.
+     * Without it the whole display is sent by display() when anything changed.
+     */
+    void setFlushFunction(FlushCallback flushFunction);
+
+    /**
+     * Flush changed windows asynchronously through chunkFunction, in
+     * chunks of up to chunkBytes, NULL for synchronous flush.
+     * update() sends chunksPerUpdate chunks, and a frame composed before
+     * the previous one drained is sent when it has; call pumpFlush()
+     * while waiting for the next update to send the rest.
+     */
+    void setAsyncFlush(FlushChunkCallback chunkFunction, uint8_t chunksPerUpdate = 4, uint8_t chunkBytes = 16);
+
+    /**
+     * Offer up to chunks chunks to the bus, 0 for as many as it takes.
+     * Returns true while the flush is still busy.
+     */
+    bool pumpFlush(uint8_t chunks = 0);
+    bool isFlushBusy();
+
+    /**
+     * Mark the panel content unknown, ie. after display() is called
+     * outside of the ui; the next update sends the whole screen.
+     */
+    void invalidateDisplay();
+
+    /**
+     * Bytes sent to the panel, total and during the last second
+     */
+    uint32_t getFlushBytesTotal();
+    uint32_t getFlushBytesPerSecond();
+
+
     // Manual Control
     void nextFrame();
     void previousFrame();
@@ -314,9 +613,73 @@ class OLEDDisplayUiAux {
      */
     void transitionToFrame(uint8_t frame);
 
+    // Alerts
+    /**
+     * Show frame `frame` before rotation for `hold` ms. The current frame is
+     * cut away on the next update, or at the end of a running transition,
+     * unless an alert of the same or higher priority is shown; then the
+     * alert waits for it. Rotation resumes at the preempted frame.
+     * The frame is shown even if disabled or not ready.
+     * Raising a pending alert again updates its priority and hold;
+     * raising the alert shown again restarts its hold.
+     */
+    void raiseAlert(uint8_t frame, uint8_t priority = 1, uint16_t hold = 10000);
+
+    /**
+     * Drop alert of `frame`, ending its hold if shown
+     */
+    void clearAlert(uint8_t frame);
+
+    /**
+     * Frame shown by alert, -1 if none
+     */
+    int8_t getAlertFrame();
+
+    /**
+     * Alerts shown, and ms from raiseAlert() to frame flushed to panel
+     */
+    uint32_t getAlertCount();
+    uint32_t getAlertLatencyLast();
+    uint32_t getAlertLatencyMax();
+    uint32_t getAlertLatencyAverage();
+
     // State Info
     OLEDDisplayUiState* getUiState();
 
-    int8_t update();
+#ifdef OLEDDISPLAYUI_PROFILE
+    // Profiling
+    /**
+     * Call time statistics since the last reset
+     */
+    UiProfile* getProfile();
+    void resetProfile();
+
+    /**
+     * Time in us under which percent % of calls finished,
+     * as upper bound of the histogram bucket
+     */
+    static uint32_t getProfilePercentile(const UiProfileStat *stat, uint8_t percent);
+
+    /**
+     * Print count, min/avg/max/p99 us and overruns of each callback called
+     */
+    void printProfile(Print *out);
+#endif
+
+    /**
+     * Update the ui when due; returns ms until the next update is due
+     */
+    int32_t update();
+
+    /**
+     * ms until the next update is due, 0 if due now, ie. after an alert
+     */
+    int32_t getTimeToUpdate();
+
+    /**
+     * Update no later than in `ms`, ie. when a clock frame rolls its
+     * seconds. Callable from frame and version callbacks; applies once.
+     */
+    void scheduleUpdate(uint32_t ms);
 };
 #endif
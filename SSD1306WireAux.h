@@ -0,0 +1,92 @@
+/*
+ * SSD1306WireAux.h - SSD1306Wire with partial page window flush
+ *
+ * displayWindow() sends one page's column range of the buffer only, so
+ * OLEDDisplayUiAux can flush changed areas instead of the whole 1 KB.
+ * sendChunk() sends a part of a window, for the asynchronous flush to
+ * return to loop() between chunks.
+ */
+
+#ifndef SSD1306WIREAUX_h
+#define SSD1306WIREAUX_h
+
+#include "SSD1306Wire.h"
+#include <Wire.h>
+#include "OLEDDisplayUiAux.h"
+
+class SSD1306WireAux : public SSD1306Wire {
+  private:
+    uint8_t             address;
+
+    inline void sendCommandAux(uint8_t command) __attribute__((always_inline)) {
+      Wire.beginTransmission(this->address);
+      Wire.write(0x80);
+      Wire.write(command);
+      Wire.endTransmission();
+    }
+
+  public:
+    SSD1306WireAux(uint8_t address, uint8_t sda, uint8_t scl) : SSD1306Wire(address, sda, scl) {
+      this->address = address;
+    }
+
+    void sendWindowAux(uint8_t page, uint8_t x0, uint8_t x1) {
+      sendCommandAux(COLUMNADDR);
+      sendCommandAux(x0);
+      sendCommandAux(x1);
+      sendCommandAux(PAGEADDR);
+      sendCommandAux(page);
+      sendCommandAux(page);
+    }
+
+    void sendDataAux(const uint8_t *data, uint16_t length) {
+      uint16_t i;
+      uint8_t n;
+
+      // 16 bytes per transmission to fit in Wire buffer as display() does
+      for (i = 0; i < length; ) {
+        Wire.beginTransmission(this->address);
+        Wire.write(0x40);
+        for (n = 0; n < 16 && i < length; n++, i++)
+          Wire.write(data[i]);
+        Wire.endTransmission();
+      }
+    }
+
+    /**
+     * Send buffer columns x0..x1 of page to the panel
+     */
+    void displayWindow(uint8_t page, uint8_t x0, uint8_t x1) {
+      sendWindowAux(page, x0, x1);
+      sendDataAux(this->buffer + page * DISPLAY_WIDTH + x0, x1 - x0 + 1);
+    }
+
+    /**
+     * Send a chunk of a window, setting the window at its first chunk.
+     * Chunks of a window must come in order.
+     */
+    void sendChunk(const FlushChunk *chunk) {
+      if (chunk->x == chunk->x0)
+        sendWindowAux(chunk->page, chunk->x0, chunk->x1);
+      sendDataAux(chunk->data, chunk->length);
+    }
+
+    /**
+     * FlushCallback for OLEDDisplayUiAux::setFlushFunction();
+     * the display given to the ui must be a SSD1306WireAux
+     */
+    static void flushWindow(OLEDDisplay *display, uint8_t page, uint8_t x0, uint8_t x1) {
+      ((SSD1306WireAux *)display)->displayWindow(page, x0, x1);
+    }
+
+    /**
+     * FlushChunkCallback for OLEDDisplayUiAux::setAsyncFlush(); Wire
+     * transfers block, so each chunk is sent at once
+     */
+    static bool flushChunk(OLEDDisplay *display, const FlushChunk *chunk) {
+      ((SSD1306WireAux *)display)->sendChunk(chunk);
+      return true;
+    }
+};
+
+#endif
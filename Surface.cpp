@@ -0,0 +1,88 @@
+/*
+ * Surface.cpp - Offscreen 1bpp bitmap in SSD1306 page layout
+ */
+
+#include <string.h>
+#include <OLEDDisplay.h>
+#include "Surface.h"
+
+
+void
+Surface::clear(void)
+{
+  memset(buffer, 0, width * pages);
+}
+
+void
+Surface::drawImage(int16_t x, int16_t y, int16_t w, int16_t h, const char *image)
+{
+  int rows = (h + 7) >> 3;  /* image bytes per column */
+  int shift = y & 7;
+  int i, r, p;
+  uint8_t b;
+
+  /* column by column, each image row on pages p and p + 1 */
+  for (i = 0; i < w; i++, x++) {
+    if (x < 0 || x >= width) {
+      image += rows;
+      continue;
+    }
+    for (r = 0; r < rows; r++) {
+      b = pgm_read_byte(image++);
+      p = (y >> 3) + r;
+      if (p >= 0 && p < pages)
+        buffer[x + p * width] |= b << shift;
+      if (shift && p + 1 >= 0 && p + 1 < pages)
+        buffer[x + (p + 1) * width] |= b >> (8 - shift);
+    }
+  }
+}
+
+/* combine one byte by op */
+static inline void
+blitByte(uint8_t *o, uint8_t s, SurfaceOp op)
+{
+  switch (op) {
+  case SURFACE_OR:      *o |= s; break;
+  case SURFACE_AND_NOT: *o &= ~s; break;
+  case SURFACE_XOR:     *o ^= s; break;
+  }
+}
+
+void
+Surface::blitTo(OLEDDisplay *d, int16_t dx, int16_t dy, int16_t sx, int16_t w, SurfaceOp op)
+{
+  uint8_t *dbuf = d->buffer;
+  int x, p, dp, shift;
+
+  /* clip to surface and display columns */
+  if (sx < 0)              { dx -= sx; w += sx; sx = 0; }
+  if (sx + w > width)      { w = width - sx; }
+  if (dx < 0)              { sx -= dx; w += dx; dx = 0; }
+  if (dx + w > DISPLAY_WIDTH) { w = DISPLAY_WIDTH - dx; }
+  if (dbuf == NULL || w <= 0)
+    return;
+
+  /* each source page lands on display pages dp and dp + 1 */
+  shift = dy & 7;
+  for (p = 0; p < pages; p++) {
+    const uint8_t *s = buffer + p * width + sx;
+    dp = (dy >> 3) + p;   /* arithmetic shift; floor for negative dy */
+    if (dp >= DISPLAY_HEIGHT / 8)
+      break;
+    if (dp >= 0) {
+      uint8_t *o = dbuf + dp * DISPLAY_WIDTH + dx;
+      if (op == SURFACE_OR)   /* common case in transitions */
+        for (x = 0; x < w; x++)
+          o[x] |= s[x] << shift;
+      else
+        for (x = 0; x < w; x++)
+          blitByte(&o[x], (uint8_t) (s[x] << shift), op);
+    }
+    if (shift && dp + 1 >= 0 && dp + 1 < DISPLAY_HEIGHT / 8) {
+      uint8_t *o = dbuf + (dp + 1) * DISPLAY_WIDTH + dx;
+      for (x = 0; x < w; x++)
+        blitByte(&o[x], s[x] >> (8 - shift), op);
+    }
+  }
+}
@@ -0,0 +1,56 @@
+/*
+ * Surface.h - Offscreen 1bpp bitmap in SSD1306 page layout
+ *
+ * Byte (x + page * width) holds pixels (x, page * 8) ~ (x, page * 8 + 7),
+ * bit 0 on top, same as OLEDDisplay buffer. Storage is given by the user.
+ */
+
+#ifndef __SURFACE_H__
+#define __SURFACE_H__
+
+#include <OLEDDisplay.h>
+
+/* how source pixels are combined into destination */
+enum SurfaceOp {
+  SURFACE_OR,       /* set pixels */
+  SURFACE_AND_NOT,  /* clear pixels, ie. mask */
+  SURFACE_XOR       /* invert pixels */
+};
+
+class Surface {
+public:
+  uint8_t *buffer;
+  int16_t width;
+  uint8_t pages;
+
+  Surface(uint8_t *_buffer, int16_t _width, uint8_t _pages) {
+    buffer = _buffer;
+    width = _width;
+    pages = _pages;
+  }
+  void setSize(int16_t _width, uint8_t _pages) {
+    width = _width;
+    pages = _pages;
+  }
+  int16_t getHeight(void) {
+    return pages * 8;
+  }
+
+  void clear(void);
+  void setPixel(int16_t x, int16_t y) {
+    if (x >= 0 && x < width && y >= 0 && y < pages * 8)
+      buffer[x + (y >> 3) * width] |= (1 << (y & 7));
+  }
+
+  /*
+   * OR page layout image w x h in PROGMEM at x, y, clipped,
+   * same as OLEDDisplay::drawFastImage()
+   */
+  void drawImage(int16_t x, int16_t y, int16_t w, int16_t h, const char *image);
+
+  /* combine columns sx ~ sx + w - 1 into display at dx, dy by op */
+  void blitTo(OLEDDisplay *d, int16_t dx, int16_t dy, int16_t sx, int16_t w,
+              SurfaceOp op = SURFACE_OR);
+};
+
+#endif  /* __SURFACE_H__ */
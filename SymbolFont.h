@@ -0,0 +1,60 @@
+/*
+ * SymbolFont.h - Small symbol fonts used as NcodeFontDraw fallback fonts
+ *
+ * ACF chars are 8 bit, so each range is a separate font to be registered
+ * with its unicode base: ACF char c is unicode uc_base + c.
+ */
+
+#ifndef __SYMBOL_FONT_H__
+#define __SYMBOL_FONT_H__
+
+/* Latin-1 symbols: U+00B0 - U+00B7 (uc_base 0x0000) */
+const char Symbol_Latin1_14[] PROGMEM = {
+/* font info as bdf cordidate */
+  7, 	/* font bounding box width */
+  10, 	/* font bounding box heigh */
+  13, 	/* font ascent */
+  3, 	/* font descent */
+  176, 	/* first char */
+  8, 	/* number of chars */
+/* jump table */
+  /* bitmap_offset_b1,b0, dwidth, bbw,bby,bbox,bboy */
+  0,  0,   5, 4,4,1,6,  	/* 0xb0 176 'degree' */
+  0,  4,   7, 5,7,1,0,  	/* 0xb1 177 'plusminus' */
+  0, 11,   4, 3,5,0,5,  	/* 0xb2 178 'twosuperior' */
+  0, 16,   4, 3,5,0,5,  	/* 0xb3 179 'threesuperior' */
+  0, 21,   0, 0,0,0,0,  	/* 0xb4 180 (not covered) */
+  0, 21,   0, 0,0,0,0,  	/* 0xb5 181 (not covered) */
+  0, 21,   0, 0,0,0,0,  	/* 0xb6 182 (not covered) */
+  0, 21,   4, 2,2,1,4,  	/* 0xb7 183 'periodcentered' */
+/* bitmap */
+  0x60,0x90,0x90,0x60,  /* 0xb0 176 'degree' */
+  0x20,0x20,0xf8,0x20,0x20,0x00,0xf8,  /* 0xb1 177 'plusminus' */
+  0xc0,0x20,0x40,0x80,0xe0,  /* 0xb2 178 'twosuperior' */
+  0xc0,0x20,0x40,0x20,0xc0,  /* 0xb3 179 'threesuperior' */
+  0xc0,0xc0,  /* 0xb7 183 'periodcentered' */
+};
+
+/* Arrows: U+2190 - U+2193 (uc_base 0x2100) */
+const char Symbol_Arrows_14[] PROGMEM = {
+/* font info as bdf cordidate */
+  9, 	/* font bounding box width */
+  9, 	/* font bounding box heigh */
+  13, 	/* font ascent */
+  3, 	/* font descent */
+  144, 	/* first char */
+  4, 	/* number of chars */
+/* jump table */
+  /* bitmap_offset_b1,b0, dwidth, bbw,bby,bbox,bboy */
+  0,  0,  11, 9,7,1,1,  	/* 0x90 144 'arrowleft' */
+  0, 14,   9, 7,9,1,0,  	/* 0x91 145 'arrowup' */
+  0, 23,  11, 9,7,1,1,  	/* 0x92 146 'arrowright' */
+  0, 37,   9, 7,9,1,0,  	/* 0x93 147 'arrowdown' */
+/* bitmap */
+  0x10,0x00,0x20,0x00,0x40,0x00,0xff,0x80,0x40,0x00,0x20,0x00,0x10,0x00,  /* 0x90 144 'arrowleft' */
+  0x10,0x38,0x54,0x92,0x10,0x10,0x10,0x10,0x10,  /* 0x91 145 'arrowup' */
+  0x04,0x00,0x02,0x00,0x01,0x00,0xff,0x80,0x01,0x00,0x02,0x00,0x04,0x00,  /* 0x92 146 'arrowright' */
+  0x10,0x10,0x10,0x10,0x10,0x92,0x54,0x38,0x10,  /* 0x93 147 'arrowdown' */
+};
+
+#endif  /* __SYMBOL_FONT_H__ */
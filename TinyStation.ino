@@ -42,15 +42,19 @@ See more at http://blog.squix.ch
 
 #define USE_WIFI      (USE_NTP || USE_EVENTDAY || USE_AQI || USE_WEATHER || USE_MQTT)
 
+#if USE_EVENTDAY && !USE_NTP
+#error "USE_EVENTDAY counts days on the NTP time, set USE_NTP too"
+#endif
+
 #if USE_WIFI
 #include <time.h>
 #include <ESP8266WiFi.h>
-#include <Ticker.h>
 #include <JsonListener.h>
 #endif
 
-#include "SSD1306Wire.h"
+#include "SSD1306WireAux.h"
 #include "OLEDDisplayUiAux.h"
+#include "CoopScheduler.h"
 #include "Wire.h"
 #if USE_WEATHER
 #include "WundergroundClient.h"
@@ -62,8 +66,12 @@ See more at http://blog.squix.ch
 #endif
 
 #include "NcodeFontDraw.h"
+#include "utf8ncode.h"
 #include "HelveticaFont.h"
 #include "NewPinetreeFont.h"
+#include "SymbolFont.h"
+#include "NcodeMarquee.h"
+#include "WidgetScreen.h"
 
 
 // defined in mk_gmtime.c and gmtime_r.c
@@ -79,11 +87,15 @@ const uint8_t PixelPin = 2;  // make sure to set this to the correct pin, ignore
 // Uart method is good for the Esp-01 or other pin restricted modules
 // NOTE: These will ignore the PIN and use GPI02 pin (D4 in WeMos d1 mini)
 NeoPixelBus<NeoGrbFeature, NeoEsp8266Uart800KbpsMethod> strip(PixelCount, PixelPin);
-RgbColor rgb_black(0, 0, 0);
-RgbColor rgb_connecting(2, 2, 2);
-RgbColor rgb_progress(0, 3, 3);
-RgbColor rgb_frame_index(0, 3, 3);
-RgbColor rgb_mqtt_noti(8, 8, 8);
+// Colors in perceptual levels, mapped to PWM by the compositor gamma
+#include "LedCompositor.h"
+void showStrip(const LedColor *pixels, uint8_t count);
+LedCompositor leds(showStrip, PixelCount);
+LedColor rgb_black = { 0, 0, 0 };
+LedColor rgb_connecting = { 28, 28, 28 };
+LedColor rgb_progress = { 0, 34, 34 };
+LedColor rgb_frame_index = { 0, 34, 34 };
+LedColor rgb_mqtt_noti = { 53, 53, 53 };
 
 #if USE_AQI
 #include "AqiCnClient.h"
@@ -137,44 +149,60 @@ const int SDC_PIN = D1;
 
 // Initialize the oled display for address 0x3c
 // sda-pin=14 and sdc-pin=12
-SSD1306Wire display(I2C_DISPLAY_ADDRESS, SDA_PIN, SDC_PIN);
+SSD1306WireAux display(I2C_DISPLAY_ADDRESS, SDA_PIN, SDC_PIN);
 OLEDDisplayUiAux ui( &display );
 
+// background work run in time left between ui updates
+CoopScheduler scheduler;
+
+// sleep in the time left to the next ui update, task or led frame
+#include "IdleManager.h"
+void idleSleep(unsigned long ms);
+IdleManager idle(idleSleep);
+
 /***************************
  * End Settings
  **************************/
 
 #if USE_NTP
-NTPClient ntpClient(NTP_SERVER, UTC_OFFSET * 3600L);
+NTPClient ntpClient(NTP_SERVER, UTC_OFFSET * 3600L, UPDATE_INTERVAL_SECS * 1000L);
+static const char *wday_str[7] = { "일", "월", "화", "수", "목", "금", "토"  };
 #endif
 
 #if USE_WEATHER
 WundergroundClient wunderground(WUNDERGROUND_IS_METRIC);
+// Copied out of the client on each update, so that frames draw from
+// fixed buffers; icons are Meteocons glyphs drawn by OLEDDisplay
+#define FORECAST_DAYS 3   // day 0, 2 and 4 of the forecast
+char weatherText[64];
+char weatherTemp[8];
+String weatherIcon;
+char forecastDay[FORECAST_DAYS][8];
+char forecastTemp[FORECAST_DAYS][16];   // low/high
+String forecastIcon[FORECAST_DAYS];
 #endif
 
 #if USE_WIFI
-// flag changed in the ticker function every 10 minutes
-bool readyForWeatherUpdate = false;
-String lastUpdate = "--";
-Ticker ticker;
+char lastUpdate[9] = "--";  // HH:MM:SS of the last NTP update
+// changed on each updateData() for frames showing downloaded data
+uint32_t dataVersion = 0;
 #endif
 
 //declaring prototypes
-void drawProgress(OLEDDisplay *display, int percentage, String label1, String label2);
+void drawProgress(OLEDDisplay *display, int percentage, const char *label1, const char *label2);
 void updateData(OLEDDisplay *display);
 
 void drawDateTime(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
 void drawCurrentWeather(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
 void drawForecast(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
 void drawThingspeak(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
-void drawForecastDetails(OLEDDisplay *display, int x, int y, int dayIndex);
+void drawForecastDetails(OLEDDisplay *display, int x, int y, int day);
 
 void drawHeaderOverlay(OLEDDisplay *display, OLEDDisplayUiState* state);
-void setReadyForWeatherUpdate();
 
 // LED strip display set
-void stripProgress(int cur, int max, RgbColor c);
-void stripTrying(int cur, int max, RgbColor c);
+void stripProgress(int cur, int max, LedColor c);
+void stripTrying(int cur, int max, LedColor c);
 void stripFrameIndex(int frameIndex, int frameCount);
 void stripAQI(int frameIndex, int frameCount);
 void stripMQTT(int frameIndex, int frameCount);
@@ -195,9 +223,10 @@ void drawEventDay(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, in
 WiFiClient espClient;
 PubSubClient mqttClient(espClient);
 // received msg
-char mqttMsg[50] = "";
+char mqttMsg[128] = "";
 long lastMsg = 0;
 int value = 0;
+int taskMqttLoopId = -1;
 void drawMQTT(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 #endif
@@ -208,7 +237,14 @@ void mqttCallback(char* topic, byte* payload, unsigned int length);
 #define MH_Z19_RX D8
 #define MH_Z19_TX D7
 MHZ co2(MH_Z19_RX, MH_Z19_TX, CO2_IN, MHZ19B);
-void drawCO2(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
+int co2_ppm = -1;
+int co2_temperature;
+bool co2_preheating = true;
+// alert when over high, again after once below low
+#define CO2_ALERT_HIGH 1500
+#define CO2_ALERT_LOW  1200
+bool co2_alert = false;
+int8_t frameCO2 = -1;
 #endif
 
 #if USE_PMS
@@ -217,64 +253,42 @@ void drawCO2(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t
 #define PMS_SET   D6
 PMS pms(Serial);
 PMS::DATA data;
+bool pms_has_data = false;
+// PM2.5 ug/m3 to alert when over high, again after once below low
+#define PMS_ALERT_HIGH 75
+#define PMS_ALERT_LOW  50
+bool pms_alert = false;
+int8_t framePMS = -1;
+int pollPMSId = -1;
 #endif
 
 
 // NcodeFont
 NcodeFontDraw nfd(Helvetica_18, NewPinetree_18, 1);
 
-// Add frames
-// this array keeps function pointers to all frames
-// frames are the single views that slide from right to left
-FrameCallback frames[] = {
-#if USE_NTP
-  drawDateTime,
-#endif
-#if USE_EVENT_DAY
-  drawEventDay,
-#endif
-#if USE_WEATHER
-  drawCurrentWeather,
-  drawForecast,
-#endif
-#if USE_AQI
-  drawAQI,
-#endif
-#if USE_MQTT
-  drawMQTT,
-#endif
+// Sensor frames as widgets, redrawn where values changed
 #if USE_CO2
-  drawCO2,
+WidgetScreen screenCO2(&nfd);
 #endif
 #if USE_PMS
-  drawPMS,
+WidgetScreen screenPMS(&nfd);
 #endif
+
+// fallback fonts for symbols not in ascii font (°, ·, arrows)
+NcodeFallbackFont fallbackFonts[] = {
+  { Symbol_Latin1_14, 0x0000 },
+  { Symbol_Arrows_14, 0x2100 },
 };
-AuxCallback auxes[]    = {
-#if USE_NTP
-  stripFrameIndex,
-#endif
-#if USE_EventDay
-  stripFrameIndex,
-#endif
-#if USE_WEATHER
-  stripFrameIndex,
-  stripFrameIndex,
-#endif
-#if USE_AQI
-  stripAQI,
-#endif
+
 #if USE_MQTT
-  stripMQTT,
+// scrolls mqttMsg wider than screen, rendered once per message
+NcodeMarquee mqttMarquee(&nfd);
 #endif
-#if USE_CO2
-  stripFrameIndex,
-#endif
-#if USE_PMS
-  stripFrameIndex,
+
+#if USE_MQTT
+// frame id from ui.addFrame() to alert on message
+int8_t frameMQTT = -1;
 #endif
-};
-int numberOfFrames = sizeof(frames) / sizeof(FrameCallback);
 
 
 void setup() {
@@ -293,6 +307,8 @@ void setup() {
   display.setTextAlignment(TEXT_ALIGN_CENTER);
   display.setContrast(255);
 
+  nfd.setFallbackFonts(fallbackFonts, sizeof(fallbackFonts) / sizeof(NcodeFallbackFont));
+
 #if USE_PMS
   Serial.begin(9600);
   pinMode(PMS_RESET, OUTPUT);
@@ -326,9 +342,14 @@ void setup() {
       WiFi.begin(wifi[wi].ssid, wifi[wi].pwd);
     }
   }
+  // delay() lets the modem and cpu sleep between DTIM beacons
+  WiFi.setSleepMode(WIFI_LIGHT_SLEEP);
 #endif
 
 #if USE_NTP
+  // time comes in the background, as loop() takes the reply
+  ntpClient.setCallback(ntpUpdated);
+  ntpClient.setWeekdayNames(wday_str);
   ntpClient.begin();
 #endif
 
@@ -350,8 +371,67 @@ void setup() {
   // SLIDE_LEFT, SLIDE_RIGHT, SLIDE_TOP, SLIDE_DOWN
   ui.setFrameAnimation(SLIDE_LEFT);
 
-  ui.setFrames(frames, numberOfFrames);
-  ui.setAuxes(auxes, numberOfFrames);
+  // Send changed page windows only instead of whole screen each tick,
+  // in chunks between loop work; loop() sends the rest while waiting
+  ui.setAsyncFlush(SSD1306WireAux::flushChunk, 4);
+
+  // Add frames: the single views that slide from right to left, in order,
+  // with aux function showing frame on led strip.
+  // Version skips redraw of unchanged frame, interval is update period in ms
+  // while shown, and frames not ready with data are skipped.
+#if USE_NTP
+  int8_t frameDateTime = ui.addFrame(drawDateTime, stripFrameIndex);
+  ui.setFrameVersion(frameDateTime, versionDateTime);
+  ui.setFrameReady(frameDateTime, readyDateTime);
+  ui.setFrameInterval(frameDateTime, 1000);  // seconds of clock, on time by versionDateTime
+  ui.setLiveFrame(frameDateTime, true);      // keep seconds ticking while sliding
+#endif
+#if USE_EVENTDAY
+  int8_t frameEventDay = ui.addFrame(drawEventDay, stripFrameIndex);
+  ui.setFrameVersion(frameEventDay, versionEventDay);
+  ui.setFrameReady(frameEventDay, readyDateTime);
+  ui.setFrameInterval(frameEventDay, 5000);
+#endif
+#if USE_WEATHER
+  int8_t frameWeather = ui.addFrame(drawCurrentWeather, stripFrameIndex);
+  ui.setFrameVersion(frameWeather, versionData);
+  ui.setFrameInterval(frameWeather, 5000);
+  int8_t frameForecast = ui.addFrame(drawForecast, stripFrameIndex);
+  ui.setFrameVersion(frameForecast, versionData);
+  ui.setFrameInterval(frameForecast, 5000);
+#endif
+#if USE_AQI
+  int8_t frameAQI = ui.addFrame(drawAQI, stripAQI);
+  ui.setFrameVersion(frameAQI, versionData);
+  ui.setFrameInterval(frameAQI, 5000);
+  ui.setFrameReady(frameAQI, readyAQI);
+#endif
+#if USE_MQTT
+  frameMQTT = ui.addFrame(drawMQTT, stripMQTT);  // scrolling: no version, full frame rate
+  ui.setFrameReady(frameMQTT, readyMQTT);
+  ui.setFrameDwell(frameMQTT, 10000);        // time to read long message
+#endif
+#if USE_CO2
+  screenCO2.addBigNumber(0, 10, 128, nfd.TEXT_ALIGN_CENTER, Helvetica_Bold_24, NewPinetree_Bold_24,
+                         "CO2: %ld", valueCO2);
+  screenCO2.addBigNumber(0, 38, 128, nfd.TEXT_ALIGN_CENTER, Helvetica_Bold_14, NewPinetree_Bold_14,
+                         "TEMP: %ld C", valueCO2Temperature);
+  frameCO2 = ui.addFrame(&screenCO2, stripFrameIndex);
+  ui.setFrameInterval(frameCO2, 1000);
+  ui.setFrameReady(frameCO2, readyCO2);
+#endif
+#if USE_PMS
+  // Unit: ug/m3
+  screenPMS.addBigNumber(0, 2, 128, nfd.TEXT_ALIGN_CENTER, Helvetica_Bold_18, NewPinetree_Bold_18,
+                         "PM1.0: %ld", valuePM1_0);
+  screenPMS.addBigNumber(0, 23, 128, nfd.TEXT_ALIGN_CENTER, Helvetica_Bold_18, NewPinetree_Bold_18,
+                         "PM2.5: %ld", valuePM2_5);
+  screenPMS.addBigNumber(0, 44, 128, nfd.TEXT_ALIGN_CENTER, Helvetica_Bold_18, NewPinetree_Bold_18,
+                         "PM10: %ld", valuePM10);
+  framePMS = ui.addFrame(&screenPMS, stripFrameIndex);
+  ui.setFrameInterval(framePMS, 1000);
+  ui.setFrameReady(framePMS, readyPMS);
+#endif
   ui.disableAllIndicators();
 
   //ui.setOverlays(overlays, numberOfOverlays);
@@ -361,291 +441,423 @@ void setup() {
 
 #if USE_WIFI
   updateData(&display);
-  ticker.attach(UPDATE_INTERVAL_SECS, setReadyForWeatherUpdate);
+#endif
+
+  // periodic updates: priority, first cost estimate in ms. Downloads
+  // taking seconds run in the budget of a frame shown for 5 s unchanged,
+  // ie. weather, forecast or AQI, not between clock seconds
+#if USE_WEATHER
+  scheduler.addTask(taskUpdateWeather, UPDATE_INTERVAL_SECS * 1000L, 1, 3000, UPDATE_INTERVAL_SECS * 1000L);
+#endif
+#if USE_AQI
+  scheduler.addTask(taskUpdateAqi, UPDATE_INTERVAL_SECS * 1000L, 1, 3000, UPDATE_INTERVAL_SECS * 1000L);
+#endif
+#if USE_CO2
+  scheduler.addTask(pollCO2, 1000, 1, 50);
+#endif
+#if USE_PMS
+  // request each second; the reply is read as it arrives, see wakeSerial()
+  scheduler.addTask(requestPMS, 1000, 1, 5);
+  pollPMSId = scheduler.addTask(pollPMS, 0, 1, 5);
+#endif
+#if USE_MQTT
+  // data arriving wakes it at once, see wakeMqtt()
+  taskMqttLoopId = scheduler.addTask(taskMqttLoop, 1000, 3, 1);
+  scheduler.addTask(taskMqttReconnect, 30 * 1000L, 2, 1000, 30 * 1000L);
+#endif
+
+  idle.addDeadline(deadlineUi);
+  idle.addDeadline(deadlineTasks);
+  idle.addDeadline(deadlineLeds);
+#if USE_NTP
+  idle.addDeadline(deadlineNtp);
+#endif
+#if USE_MQTT
+  idle.addWake(wakeMqtt);
+#endif
+#if USE_PMS
+  idle.addWake(wakeSerial);
 #endif
 }
 
 void loop() {
-#if USE_WIFI
-  if (readyForWeatherUpdate && ui.getUiState()->frameState == FIXED)
-    updateData(&display);
+  long remainingTimeBudget = ui.update();
+  // strip animations run on the same millis() as the ui
+  leds.update(millis());
+
+  // Display chunks left go out first, the frame composed while they
+  // drained included, so a long task does not hold a half sent frame
+  unsigned long flushStart = millis();
+  while (ui.isFlushBusy() && (long) (millis() - flushStart) < remainingTimeBudget)
+    ui.pumpFlush(1);
+  remainingTimeBudget -= millis() - flushStart;
+
+  // Do background work within time budget to next ui update
+  remainingTimeBudget = scheduler.run(remainingTimeBudget);
+#if USE_NTP
+  // sends a request when due, takes the reply once there
+  ntpClient.update();
+#endif
+  // next deadline of ui, alert raised by a task included, tasks and leds;
+  // sleep until then, unless sensor or MQTT data comes
+  remainingTimeBudget = idle.getTimeToDeadline(remainingTimeBudget);
+  if (remainingTimeBudget > 0)
+    idle.wait(remainingTimeBudget);
+}
+
+// Idle sleep and its deadline and wake sources
+
+void idleSleep(unsigned long ms) {
+  delay(ms);  // light sleep with WIFI_LIGHT_SLEEP set
+}
+
+long deadlineUi() {
+  long t = ui.getTimeToUpdate();
+  return (t > 0)? t : 0;
+}
+
+long deadlineTasks() {
+  // with the budget run() gets next; long updates wait for a long frame
+  long budget = ui.getTimeToUpdate();
+  return scheduler.getNextDue((budget > 0)? budget : 0);  // sensor polls included
+}
+
+long deadlineLeds() {
+  return leds.getTimeToUpdate(millis());
+}
+
+#if USE_NTP
+long deadlineNtp() {
+  return ntpClient.getTimeToUpdate();  // reply polled while waiting
+}
 #endif
 
 #if USE_MQTT
-  if (mqttClient.connected())
-    mqttClient.loop();
+bool wakeMqtt() {
+  if (!mqttClient.connected() || espClient.available() <= 0)
+    return false;
+  scheduler.schedule(taskMqttLoopId, 0);
+  return true;
+}
 #endif
 
-  int remainingTimeBudget = ui.update();
-  if (remainingTimeBudget > 0) {
-    // You can do some work here
-    // Don't do stuff if you are below your
-    // time budget.
-    delay(remainingTimeBudget);
-  }
+#if USE_PMS
+bool wakeSerial() {
+  if (Serial.available() <= 0)
+    return false;
+  scheduler.schedule(pollPMSId, 0);
+  return true;
 }
+#endif
 
-void drawProgress(OLEDDisplay *display, int percentage, String label1, String label2) {
-  char s[100];
-  
+void drawProgress(OLEDDisplay *display, int percentage, const char *label1, const char *label2) {
   display->clear();
-  label1.toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_14, NewPinetree_14);
-  nfd.drawStringMaxWidth(display, 64, 4, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawStringMaxWidth(display, 64, 4, nfd.TEXT_ALIGN_CENTER, 128, label1);
 
-  label2.toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_18, NewPinetree_18);
-  nfd.drawStringMaxWidth(display, 64, 30, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawStringMaxWidth(display, 64, 30, nfd.TEXT_ALIGN_CENTER, 128, label2);
   display->display();
+  ui.invalidateDisplay();
   
   stripProgress(percentage, 100, rgb_progress);
 }
 
+// update all with progress on screen at boot; tasks below do it later
 void updateData(OLEDDisplay *display) {
 
-#if USE_NTP
-  drawProgress(display, 10, "Updating", "Time");
-  ntpClient.update();
-  lastUpdate = ntpClient.getFormattedTime();
-#endif
-
 #if USE_WEATHER
   drawProgress(display, 30, "Updating", "Weather");
-  wunderground.updateConditions(WUNDERGROUND_API_KEY, WUNDERGROUND_LANGUAGE, WUNDERGROUND_COUNTRY, WUNDERGROUND_CITY);
+  taskUpdateWeather();
 
   //drawProgress(display, 50, "Updating", "Forecasts");
   //wunderground.updateForecast(WUNDERGROUND_API_KEY, WUNDERGROUND_LANGUAGE, WUNDERGROUND_COUNTRY, WUNDERGROUND_CITY);
+#endif
 
-  //drawProgress(display, 60, "Updating", "AQI Data");
-  //aqi.doUpdate();
-  readyForWeatherUpdate = false;
+#if USE_AQI
+  drawProgress(display, 60, "Updating", "AQI Data");
+  taskUpdateAqi();
 #endif
 
 #if USE_MQTT
-  // MQTT Reconnect Check
-  if (!mqttClient.connected()) { 
-    drawProgress(display, 70, "Reconnecting", "MQTT Broker");
-    if (mqttClient.connect("ESP8266Client", mqttUser, mqttPwd)) {
-      mqttClient.publish(mqttTopic, "hello world");
-      mqttClient.subscribe(mqttTopic);
-    }
-    else {
-      strcpy(mqttMsg, "(not connected)");
-    }
-    delay(1000);
-  }
+  drawProgress(display, 70, "Connecting", "MQTT Broker");
+  taskMqttReconnect();
 #endif
 
   drawProgress(display, 100, "Updating", "Done");
-  delay(1000);
+  // let the progress sweep finish
+  unsigned long doneStart = millis();
+  while (millis() - doneStart < 1000) {
+    leds.update(millis());
+    delay(LED_FRAME_INTERVAL);
+  }
 }
 
 #if USE_NTP
-void drawDateTime(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  static const char *wday_str[7] = { "일", "월", "화", "수", "목", "금", "토"  };
-  char s[100];
+// NTP request completed; retries on failure back off in NTPClient
+void ntpUpdated(bool success) {
+  if (success)
+    strcpy(lastUpdate, ntpClient.getTimeString());
+}
 
-  time_t curTime = ntpClient.getRawTime() - 946684800L/*UNIX_OFFSET*/;  // change epoch: 1970->2000
-  struct tm tv;
-  gmtime_r(&curTime, &tv);
-  sprintf(s, "%d.%d.%d (%s)", tv.tm_year + 1900, tv.tm_mon + 1, tv.tm_mday, wday_str[tv.tm_wday]);
+// Frames of the date, DateTime and EventDay, wait for the first reply;
+// until then getRawTime() counts from boot
+bool readyDateTime(int frameIndex, int frameCount) {
+  return ntpClient.isTimeSet();
+}
+#endif
+
+#if USE_WEATHER
+void taskUpdateWeather() {
+  wunderground.updateConditions(WUNDERGROUND_API_KEY, WUNDERGROUND_LANGUAGE, WUNDERGROUND_COUNTRY, WUNDERGROUND_CITY);
+
+  wunderground.getWeatherText().toCharArray(weatherText, sizeof(weatherText));
+  wunderground.getCurrentTemp().toCharArray(weatherTemp, sizeof(weatherTemp));
+  weatherIcon = wunderground.getTodayIcon();
+  for (int i = 0; i < FORECAST_DAYS; i++) {
+    String day = wunderground.getForecastTitle(i * 2).substring(0, 3);
+    day.toUpperCase();
+    day.toCharArray(forecastDay[i], sizeof(forecastDay[i]));
+    snprintf(forecastTemp[i], sizeof(forecastTemp[i]), "%s/%s",
+             wunderground.getForecastLowTemp(i * 2).c_str(), wunderground.getForecastHighTemp(i * 2).c_str());
+    forecastIcon[i] = wunderground.getForecastIcon(i * 2);
+  }
+  dataVersion++;
+}
+#endif
+
+#if USE_AQI
+void taskUpdateAqi() {
+  aqi.doUpdate();
+  dataVersion++;
+}
+#endif
+
+#if USE_MQTT
+void taskMqttLoop() {
+  if (mqttClient.connected())
+    mqttClient.loop();
+}
+
+void taskMqttReconnect() {
+  if (mqttClient.connected())
+    return;
+  if (mqttClient.connect("ESP8266Client", mqttUser, mqttPwd)) {
+    mqttClient.publish(mqttTopic, "hello world");
+    mqttClient.subscribe(mqttTopic);
+  }
+  else {
+    strcpy(mqttMsg, "(not connected)");
+    mqttMarquee.setText(Helvetica_18, NewPinetree_18, mqttMsg);
+  }
+}
+#endif
+
+#if USE_NTP
+void drawDateTime(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+  // formatted in NTPClient once per second, shared by transition draws
   nfd.setFont(Helvetica_Bold_14, NewPinetree_Bold_14);
-  nfd.drawStringMaxWidth(display, 64 + x, 6 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
-  
-  String time = ntpClient.getFormattedTime();
-  time.toCharArray(s, sizeof(s));
+  nfd.drawString(display, 64 + x, 6 + y, nfd.TEXT_ALIGN_CENTER, ntpClient.getDateString());
+
   nfd.setFont(Helvetica_Bold_24, NewPinetree_Bold_24);
-  nfd.drawStringMaxWidth(display, 64 + x, 30 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawString(display, 64 + x, 30 + y, nfd.TEXT_ALIGN_CENTER, ntpClient.getTimeString());
+}
+
+uint32_t versionDateTime(int frameIndex, int frameCount) {
+  uint64_t ms = ntpClient.getEpochMillis();
+  ui.scheduleUpdate(1000 - ms % 1000);  // roll seconds on time
+  return ms / 1000;  // redraw each second
 }
 #endif
 
 #if USE_WEATHER
 void drawCurrentWeather(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  char s[100];
-    
-  String weather = wunderground.getWeatherText();
-  weather.toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_Bold_14, NewPinetree_Bold_14);
-  nfd.drawStringMaxWidth(display, 58 + x, 10 + y, nfd.TEXT_ALIGN_LEFT, 128, s);
+  nfd.drawStringMaxWidth(display, 58 + x, 10 + y, nfd.TEXT_ALIGN_LEFT, 128, weatherText);
 
-  String temp = wunderground.getCurrentTemp() + "°C";
-  temp.toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_Bold_24, NewPinetree_Bold_24);
-  nfd.drawStringMaxWidth(display, 58 + x, 30 + y, nfd.TEXT_ALIGN_LEFT, 128, s);
+  nfd.drawf(display, 58 + x, 30 + y, nfd.TEXT_ALIGN_LEFT, "%s°C", weatherTemp);
 
   display->setFont(Meteocons_Plain_42);
   display->setTextAlignment(TEXT_ALIGN_CENTER);
-  String weatherIcon = wunderground.getTodayIcon();
-  int weatherIconWidth = display->getStringWidth(weatherIcon);
   display->drawString(29 + x, 12 + y, weatherIcon);
 }
 
 void drawForecast(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  drawForecastDetails(display, x, y, 0);
-  drawForecastDetails(display, x + 44, y, 2);
-  drawForecastDetails(display, x + 88, y, 4);
+  for (int i = 0; i < FORECAST_DAYS; i++)
+    drawForecastDetails(display, x + i * 44, y, i);
 }
 
-void drawForecastDetails(OLEDDisplay *display, int x, int y, int dayIndex) {
-  char s[100];
-
-  String day = wunderground.getForecastTitle(dayIndex).substring(0, 3);
-  day.toUpperCase();
-  day.toCharArray(s, sizeof(s));
+void drawForecastDetails(OLEDDisplay *display, int x, int y, int day) {
   nfd.setFont(Helvetica_14, NewPinetree_14);
-  nfd.drawStringMaxWidth(display, 20 + x, 2 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawStringMaxWidth(display, 20 + x, 2 + y, nfd.TEXT_ALIGN_CENTER, 128, forecastDay[day]);
 
   display->setFont(Meteocons_Plain_21);
-  display->drawString(x + 20, 24 + y, wunderground.getForecastIcon(dayIndex));
+  display->drawString(x + 20, 24 + y, forecastIcon[day]);
 
-  (wunderground.getForecastLowTemp(dayIndex) + "/" + wunderground.getForecastHighTemp(dayIndex)).toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_14, NewPinetree_14);
-  nfd.drawStringMaxWidth(display, 20 + x, 48 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawString(display, 20 + x, 48 + y, nfd.TEXT_ALIGN_CENTER, forecastTemp[day]);
 }
 #endif
 
 #if USE_WIFI
-void setReadyForWeatherUpdate() {
-  readyForWeatherUpdate = true;
+uint32_t versionData(int frameIndex, int frameCount) {
+  return dataVersion;
 }
 #endif
 
 
 // LED Strip
 
-void stripProgress(int cur, int max, RgbColor c) {
-  int i, num_led = 4;
-  for (i = 0; i < num_led; i++) {
-    // (i / num_led >= cur / max ) * (num_led * max) to remove divider part
-    if (i * max  <= cur * num_led)
-      strip.SetPixelColor(i, c);
-    else
-      strip.SetPixelColor(i, RgbColor(0, 0, 0));
-  }
+void showStrip(const LedColor *pixels, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++)
+    strip.SetPixelColor(i, RgbColor(pixels[i].r, pixels[i].g, pixels[i].b));
   strip.Show();
 }
 
-void stripTrying(int cur, int max, RgbColor c) {
-  int i, num_led = 4;
-  for (i = 0; i < num_led; i++) {
-    if (i == cur * num_led / (max + 1))
-      strip.SetPixelColor(i, c);
-    else
-      strip.SetPixelColor(i, RgbColor(0, 0, 0));
-  }
-  strip.Show();
+// Strip functions set the state wanted; leds.update() shows it when changed
+
+void stripProgress(int cur, int max, LedColor c) {
+  leds.progress(cur, max, c);
+  leds.update(millis());
+}
+
+void stripTrying(int cur, int max, LedColor c) {
+  leds.fill(rgb_black);
+  leds.setPixel(cur * PixelCount / (max + 1), c);
+  leds.update(millis());
 }
 
 void stripFrameIndex(int frameIndex, int frameCount) {
   // led strip to show pending message counts
-  for (int i = 0; i < 4; i++) 
-      strip.SetPixelColor(i, (i + 1 == 4 * (frameIndex + 1) / frameCount)? rgb_frame_index : rgb_black);
-  strip.Show();
+  leds.fill(rgb_black);
+  for (int i = 0; i < PixelCount; i++)
+    if (i + 1 == PixelCount * (frameIndex + 1) / frameCount)
+      leds.setPixel(i, rgb_frame_index);
 }
 
 #if USE_AQI
+// AQI scale colors, a pixel lit per 50
+const LedGradientStop AQI_STOPS[] PROGMEM = {
+  {   0, {   0, 228,   0 } },
+  {  50, { 255, 255,   0 } },
+  { 100, { 255, 126,   0 } },
+  { 150, { 255,   0,   0 } },
+  { 200, { 143,  63, 151 } },
+  { 300, { 126,   0,  35 } },
+};
+
 void stripAQI(int frameIndex, int frameCount) {
-  RgbColor c = RgbColor(aqi.r * 4 / 255, aqi.g * 4 / 255, aqi.b * 4 / 255);
-  strip.SetPixelColor(0, (aqi.val >= 0)?   c : rgb_black);
-  strip.SetPixelColor(1, (aqi.val >= 50)?  c : rgb_black);
-  strip.SetPixelColor(2, (aqi.val >= 100)? c : rgb_black);
-  strip.SetPixelColor(3, (aqi.val >= 150)? c : rgb_black);
-  strip.Show();
+  leds.gradient(aqi.val, 50, AQI_STOPS, sizeof(AQI_STOPS) / sizeof(LedGradientStop), 39);
 }
 #endif
 
 #if USE_MQTT
 void stripMQTT(int frameIndex, int frameCount) {
-  strip.SetPixelColor(0, rgb_mqtt_noti);
-  strip.SetPixelColor(1, rgb_black);
-  strip.SetPixelColor(2, rgb_black);
-  strip.SetPixelColor(3, rgb_mqtt_noti);
-  strip.Show();
+  leds.breathe(rgb_mqtt_noti, 2000, 0x09);  // end pixels
+  leds.setPixel(1, rgb_black);
+  leds.setPixel(2, rgb_black);
 }
 #endif
 
 #if USE_AQI
+bool readyAQI(int frameIndex, int frameCount) {
+  return aqi.val_s.length() > 0;
+}
+
 void drawAQI(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  char s[100];
-    
-  aqi.level.toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_14, NewPinetree_14);
-  nfd.drawStringMaxWidth(display, 64 + x, 2 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawStringMaxWidth(display, 64 + x, 2 + y, nfd.TEXT_ALIGN_CENTER, 128, aqi.level.c_str());
 
-  ("AQI " + aqi.val_s).toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_Bold_24, NewPinetree_Bold_24);
-  nfd.drawStringMaxWidth(display, 64 + x, 20 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawf(display, 64 + x, 20 + y, nfd.TEXT_ALIGN_CENTER, "AQI %s", aqi.val_s.c_str());
 
-  aqi.dominentpol.toCharArray(s, sizeof(s));
   nfd.setFont(Helvetica_14, NewPinetree_14);
-  nfd.drawStringMaxWidth(display, 64 + x, 46 + y, nfd.TEXT_ALIGN_CENTER, 128, s);
+  nfd.drawStringMaxWidth(display, 64 + x, 46 + y, nfd.TEXT_ALIGN_CENTER, 128, aqi.dominentpol.c_str());
 }
 #endif
 
 #if USE_CO2
 // MH-Z19B CO2 Sensor
-void drawCO2(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  static int last_ppm_uart = -1;
-  static unsigned long last_millis = 0;
-  static int is_preheating = 1;
-  static char s[3][100] = { "Initializing...", "", "" };
-  int ppm_uart, temparature;
-
-  if (millis() >= last_millis + 1000) {
-    if (co2.isPreHeating()) {
-      sprintf(s[0], "Preheating...");
-      is_preheating = 1;
-    }
-    else {
-      ppm_uart = co2.readCO2UART();
-      temparature = co2.getLastTemperature();
-      if (ppm_uart < 0) {
-        ppm_uart = last_ppm_uart;
-      } else {
-        last_ppm_uart = ppm_uart;
-      }
-      sprintf(s[1], "CO2: %d", ppm_uart);
-      sprintf(s[2], "TEMP: %d C", temparature);
-      is_preheating = 0;
-    }
-    last_millis = millis();
-  }
+// scheduler task reading sensor in background
+void pollCO2() {
+  int ppm_uart;
 
-  if (is_preheating) {
-    nfd.setFont(Helvetica_18, NewPinetree_18);
-    nfd.drawStringMaxWidth(display, 64 + x, 22 + y, nfd.TEXT_ALIGN_CENTER, 128, s[0]);    
+  if (co2.isPreHeating()) {
+    co2_preheating = true;
+    return;
   }
-  else {
-    nfd.setFont(Helvetica_Bold_24, NewPinetree_Bold_24);
-    nfd.drawStringMaxWidth(display, 64 + x, 10 + y, nfd.TEXT_ALIGN_CENTER, 128, s[1]);
-    nfd.setFont(Helvetica_Bold_14, NewPinetree_Bold_14);
-    nfd.drawStringMaxWidth(display, 64 + x, 38 + y, nfd.TEXT_ALIGN_CENTER, 128, s[2]);
+  ppm_uart = co2.readCO2UART();
+  if (ppm_uart >= 0)
+    co2_ppm = ppm_uart;
+  co2_temperature = co2.getLastTemperature();
+  co2_preheating = false;
+
+  if (!co2_alert && co2_ppm >= CO2_ALERT_HIGH) {
+    co2_alert = true;
+    ui.raiseAlert(frameCO2, 3, 10000);
+  }
+  else if (co2_alert && co2_ppm < CO2_ALERT_LOW) {
+    co2_alert = false;
+    ui.clearAlert(frameCO2);
   }
 }
+
+bool readyCO2(int frameIndex, int frameCount) {
+  return !co2_preheating && co2_ppm >= 0;
+}
+
+// Values bound to screenCO2 widgets
+int32_t valueCO2() {
+  return co2_ppm;
+}
+
+int32_t valueCO2Temperature() {
+  return co2_temperature;
+}
 #endif
 
 #if USE_PMS
 // PLANTOWER PM2.5 PMS7003 / G7 PMS Sensor
-void drawPMS(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  static unsigned long last_millis = 0;
-  static char s[3][100] = { "", "Initializing...", "" };
-  int ppm_uart, temparature;
-
-  if (millis() >= last_millis + 1000) {
-    pms.requestRead();
-    if (pms.readUntil(data)) {
-      // Unit: ug/m3
-      sprintf(s[0], "PM1.0: %d", data.PM_AE_UG_1_0);
-      sprintf(s[1], "PM2.5: %d", data.PM_AE_UG_2_5);
-      sprintf(s[2], "PM10: %d", data.PM_AE_UG_10_0);
+// Passive mode: requestPMS() asks for a reading, pollPMS() parses the
+// bytes received so far, so a missing or slow sensor never blocks loop()
+void requestPMS() {
+  pollPMS();  // reply not woken for, ie. when loop() was busy
+  pms.requestRead();
+}
+
+void pollPMS() {
+  while (Serial.available() > 0) {
+    if (!pms.read(data))  // one byte, true when a frame is complete
+      continue;
+    pms_has_data = true;
+
+    if (!pms_alert && data.PM_AE_UG_2_5 >= PMS_ALERT_HIGH) {
+      pms_alert = true;
+      ui.raiseAlert(framePMS, 3, 10000);
+    }
+    else if (pms_alert && data.PM_AE_UG_2_5 < PMS_ALERT_LOW) {
+      pms_alert = false;
+      ui.clearAlert(framePMS);
     }
-    last_millis = millis();
   }
-  
-  nfd.setFont(Helvetica_Bold_18, NewPinetree_Bold_18);
-  nfd.drawStringMaxWidth(display, 64 + x, 2 + y, nfd.TEXT_ALIGN_CENTER, 128, s[0]);
-  nfd.drawStringMaxWidth(display, 64 + x, 23 + y, nfd.TEXT_ALIGN_CENTER, 128, s[1]);
-  nfd.drawStringMaxWidth(display, 64 + x, 44 + y, nfd.TEXT_ALIGN_CENTER, 128, s[2]);
+}
+
+bool readyPMS(int frameIndex, int frameCount) {
+  return pms_has_data;
+}
+
+// Values bound to screenPMS widgets
+int32_t valuePM1_0() {
+  return data.PM_AE_UG_1_0;
+}
+
+int32_t valuePM2_5() {
+  return data.PM_AE_UG_2_5;
+}
+
+int32_t valuePM10() {
+  return data.PM_AE_UG_10_0;
 }
 #endif
 
@@ -664,14 +876,16 @@ void drawEventDay(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, in
   time_t curTime = ntpClient.getRawTime() - 946684800L/*UNIX_OFFSET*/;  // change epoch: 1970->2000
   int dayCount =  curTime / 86400L - baseTime / 86400UL;  // dayCount starts at 0
   
-  char eventMsg[32];
-  sprintf(eventMsg, "산이 %d 일째", dayCount + 1);  // start at 1
   nfd.setFont(Helvetica_18, NewPinetree_18);
-  nfd.drawStringMaxWidth(display, x + 64, 20 + y, nfd.TEXT_ALIGN_CENTER, 128, eventMsg);
+  nfd.drawf(display, x + 64, 20 + y, nfd.TEXT_ALIGN_CENTER, "산이 %d 일째", dayCount + 1);  // start at 1
 
-  sprintf(eventMsg, "%d개월+%d : %d주+%d", dayCount / 30, dayCount % 30, dayCount / 7, dayCount % 7);
   nfd.setFont(Helvetica_Bold_14, NewPinetree_Bold_14);
-  nfd.drawStringMaxWidth(display, x + 64, 42 + y, nfd.TEXT_ALIGN_CENTER, 128, eventMsg);
+  nfd.drawf(display, x + 64, 42 + y, nfd.TEXT_ALIGN_CENTER, "%d개월+%d : %d주+%d",
+            dayCount / 30, dayCount % 30, dayCount / 7, dayCount % 7);
+}
+
+uint32_t versionEventDay(int frameIndex, int frameCount) {
+  return ntpClient.getRawTime() / 86400L;  // redraw each day
 }
 #endif
 
@@ -683,14 +897,20 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
   if (length > 0)
     memcpy(mqttMsg, payload, length);
   mqttMsg[length] = '\0';
-  ui.switchToFrame(4);
+  // compose jamo sequences from phones into syllables once here
+  utf8_compose_hangul((unsigned char *)mqttMsg, (unsigned char *)mqttMsg, sizeof(mqttMsg));
+  mqttMarquee.setText(Helvetica_18, NewPinetree_18, mqttMsg);
+  ui.raiseAlert(frameMQTT, 2, 10000);  // message dwell
+}
+
+bool readyMQTT(int frameIndex, int frameCount) {
+  return mqttMsg[0] != '\0';
 }
 
 void drawMQTT(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
   nfd.setFont(Helvetica_12, NewPinetree_12);
   nfd.drawStringMaxWidth(display, x + 64, 2 + y, nfd.TEXT_ALIGN_CENTER, 128, "Message");
-  nfd.setFont(Helvetica_18, NewPinetree_18);
-  nfd.drawStringMaxWidth(display, x + 64, 20 + y, nfd.TEXT_ALIGN_CENTER, 128, mqttMsg);
+  mqttMarquee.draw(display, x, 20 + y);
 }
 #endif
 
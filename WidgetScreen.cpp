@@ -0,0 +1,360 @@
+/*
+ * WidgetScreen.cpp - Retained widgets of a frame, redrawn when their data changed
+ */
+
+#include <Arduino.h>
+#include <OLEDDisplay.h>
+#include "WidgetScreen.h"
+
+
+static uint32_t
+hash_text(const char *s)
+  /* FNV-1a; NULL same as empty */
+{
+  uint32_t h = 2166136261u;
+
+  if (s == NULL)
+    return h;
+  while (*s)
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  return h;
+}
+
+static void
+clear_box(OLEDDisplay *d, int x, int y, int w, int h)
+  /* clear pixels of box in buffer, clipped to display */
+{
+  uint8_t *row;
+  uint8_t mask;
+  int x1 = x + w, y1 = y + h;
+  int page, i, top, bottom;
+
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (x1 > DISPLAY_WIDTH) x1 = DISPLAY_WIDTH;
+  if (y1 > DISPLAY_HEIGHT) y1 = DISPLAY_HEIGHT;
+  if (x >= x1 || y >= y1)
+    return;
+
+  for (page = y / 8; page <= (y1 - 1) / 8; page++) {
+    top = (page * 8 > y)? 0 : y & 7;
+    bottom = (page * 8 + 8 < y1)? 8 : y1 - page * 8;
+    mask = (uint8_t)((0xff << top) & (0xff >> (8 - bottom)));
+    row = d->buffer + page * DISPLAY_WIDTH;
+    for (i = x; i < x1; i++)
+      row[i] &= ~mask;
+  }
+}
+
+static bool
+overlaps(Widget *a, Widget *b)
+{
+  return a->x < b->x + b->w && b->x < a->x + a->w &&
+         a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+int
+WidgetScreen::addWidget(uint8_t type, int x, int y, int w, int h)
+{
+  Widget *wd;
+
+  if (count >= WIDGET_MAX)
+    return -1;
+  wd = &widgets[count];
+  memset(wd, 0, sizeof(*wd));
+  wd->type = type;
+  wd->x = x;
+  wd->y = y;
+  wd->w = w;
+  wd->h = h;
+  wd->dirty = true;
+  version++;
+  return count++;
+}
+
+int
+WidgetScreen::addLabel(int x, int y, int w, int align,
+                       const char *ascii_font, const char *ncode_font,
+                       const char *text, WidgetTextFunction text_function)
+{
+  int id;
+
+  nfd->setFont(ascii_font, ncode_font);
+  id = addWidget(WIDGET_LABEL, x, y, w, nfd->getFontHeight());
+  if (id < 0)
+    return -1;
+  widgets[id].align = align;
+  widgets[id].ascii_font = ascii_font;
+  widgets[id].ncode_font = ncode_font;
+  widgets[id].text = text;
+  widgets[id].text_function = text_function;
+  return id;
+}
+
+int
+WidgetScreen::addBigNumber(int x, int y, int w, int align,
+                           const char *ascii_font, const char *ncode_font,
+                           const char *format, WidgetValueFunction value_function)
+{
+  int id;
+
+  nfd->setFont(ascii_font, ncode_font);
+  id = addWidget(WIDGET_BIG_NUMBER, x, y, w, nfd->getFontHeight());
+  if (id < 0)
+    return -1;
+  widgets[id].align = align;
+  widgets[id].ascii_font = ascii_font;
+  widgets[id].ncode_font = ncode_font;
+  widgets[id].text = format;
+  widgets[id].value_function = value_function;
+  return id;
+}
+
+int
+WidgetScreen::addIcon(int x, int y, int w, int h,
+                      const char *const *images, uint8_t image_count,
+                      WidgetValueFunction value_function)
+{
+  int id = addWidget(WIDGET_ICON, x, y, w, h);
+
+  if (id < 0)
+    return -1;
+  widgets[id].images = images;
+  widgets[id].image_count = image_count;
+  widgets[id].value_function = value_function;
+  return id;
+}
+
+int
+WidgetScreen::addProgressBar(int x, int y, int w, int h, int32_t min, int32_t max,
+                             WidgetValueFunction value_function)
+{
+  int id = addWidget(WIDGET_PROGRESS_BAR, x, y, w, h);
+
+  if (id < 0)
+    return -1;
+  widgets[id].min = min;
+  widgets[id].max = (max > min)? max : min + 1;
+  widgets[id].value_function = value_function;
+  return id;
+}
+
+int
+WidgetScreen::addSparkline(int x, int y, int w, int h, int16_t *samples, uint8_t sample_size,
+                           int32_t min, int32_t max)
+{
+  int id = addWidget(WIDGET_SPARKLINE, x, y, w, h);
+
+  if (id < 0)
+    return -1;
+  widgets[id].samples = samples;
+  widgets[id].sample_size = sample_size;
+  widgets[id].min = min;
+  widgets[id].max = max;
+  return id;
+}
+
+void
+WidgetScreen::setText(int id, const char *text)
+{
+  if (id < 0 || id >= count)
+    return;
+  widgets[id].text = text;
+  invalidate(id);
+}
+
+void
+WidgetScreen::pushSample(int id, int16_t value)
+{
+  Widget *wd;
+
+  if (id < 0 || id >= count || widgets[id].type != WIDGET_SPARKLINE ||
+      widgets[id].sample_size == 0)
+    return;
+  wd = &widgets[id];
+  wd->samples[wd->sample_head] = value;
+  wd->sample_head = (wd->sample_head + 1) % wd->sample_size;
+  if (wd->sample_count < wd->sample_size)
+    wd->sample_count++;
+  wd->sample_serial++;
+}
+
+void
+WidgetScreen::invalidate(int id)
+{
+  if (id < 0 || id >= count || widgets[id].dirty)
+    return;
+  widgets[id].dirty = true;
+  version++;
+}
+
+int
+WidgetScreen::textX(Widget *wd)
+  /* anchor x of text aligned in box */
+{
+  switch (wd->align) {
+  case NcodeFontDraw::TEXT_ALIGN_CENTER:
+    return wd->x + wd->w / 2;
+  case NcodeFontDraw::TEXT_ALIGN_RIGHT:
+    return wd->x + wd->w;
+  default:
+    return wd->x;
+  }
+}
+
+uint32_t
+WidgetScreen::keyOf(Widget *wd)
+  /* what the widget would draw now, as compared with key drawn */
+{
+  int32_t v;
+
+  switch (wd->type) {
+  case WIDGET_LABEL:
+    return hash_text(wd->text_function? (wd->text_function)() : wd->text);
+  case WIDGET_BIG_NUMBER:
+  case WIDGET_ICON:
+    return (uint32_t)(wd->value_function)();
+  case WIDGET_PROGRESS_BAR:
+    v = (wd->value_function)();
+    if (v < wd->min) v = wd->min;
+    if (v > wd->max) v = wd->max;
+    /* fill px inside 1 px frame */
+    return (int64_t)(v - wd->min) * (wd->w - 2) / (wd->max - wd->min);
+  case WIDGET_SPARKLINE:
+    return wd->sample_serial;
+  }
+  return 0;
+}
+
+uint32_t
+WidgetScreen::poll(void)
+{
+  Widget *wd;
+
+  for (wd = widgets; wd < widgets + count; wd++) {
+    if (!wd->dirty && keyOf(wd) != wd->key) {
+      wd->dirty = true;
+      version++;
+    }
+  }
+  return version;
+}
+
+void
+WidgetScreen::rasterize(OLEDDisplay *d, Widget *wd, int x, int y)
+  /* draw widget offset by x, y and take its key as drawn */
+{
+  int32_t lo, hi, v;
+  int i, n, slot, px, py, last_px = 0, last_py = 0;
+
+  wd->key = keyOf(wd);
+  wd->dirty = false;
+  x += wd->x;
+  y += wd->y;
+
+  switch (wd->type) {
+  case WIDGET_LABEL:
+    nfd->setFont(wd->ascii_font, wd->ncode_font);
+    nfd->drawString(d, textX(wd) - wd->x + x, y, wd->align,
+                    wd->text_function? (wd->text_function)() : wd->text);
+    break;
+
+  case WIDGET_BIG_NUMBER:
+    nfd->setFont(wd->ascii_font, wd->ncode_font);
+    nfd->drawf(d, textX(wd) - wd->x + x, y, wd->align, wd->text, (long)(int32_t)wd->key);
+    break;
+
+  case WIDGET_ICON:
+    if (wd->key < wd->image_count)
+      d->drawXbm(x, y, wd->w, wd->h, wd->images[wd->key]);
+    break;
+
+  case WIDGET_PROGRESS_BAR:
+    d->drawRect(x, y, wd->w, wd->h);
+    if (wd->key > 0)
+      d->fillRect(x + 1, y + 1, wd->key, wd->h - 2);
+    break;
+
+  case WIDGET_SPARKLINE:
+    n = wd->sample_count;
+    if (n == 0)
+      break;
+    lo = wd->min;
+    hi = wd->max;
+    if (lo >= hi) {
+      /* auto range of samples held */
+      lo = hi = wd->samples[(wd->sample_head + wd->sample_size - n) % wd->sample_size];
+      for (i = 0; i < n; i++) {
+        v = wd->samples[(wd->sample_head + wd->sample_size - n + i) % wd->sample_size];
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+      }
+      if (lo == hi)
+        hi = lo + 1;
+    }
+    /* slot sample_size - 1 at right edge, oldest held sample leftmost */
+    for (i = 0; i < n; i++) {
+      v = wd->samples[(wd->sample_head + wd->sample_size - n + i) % wd->sample_size];
+      if (v < lo) v = lo;
+      if (v > hi) v = hi;
+      slot = wd->sample_size - n + i;
+      px = x + ((wd->sample_size > 1)? slot * (wd->w - 1) / (wd->sample_size - 1) : wd->w - 1);
+      py = y + wd->h - 1 - (int)((int64_t)(v - lo) * (wd->h - 1) / (hi - lo));
+      if (i == 0)
+        d->setPixel(px, py);
+      else
+        d->drawLine(last_px, last_py, px, py);
+      last_px = px;
+      last_py = py;
+    }
+    break;
+  }
+  raster_count++;
+}
+
+void
+WidgetScreen::draw(OLEDDisplay *d, int x, int y)
+{
+  Widget *wd;
+
+  for (wd = widgets; wd < widgets + count; wd++)
+    rasterize(d, wd, x, y);
+  /* incremental update is valid on this buffer only if drawn at rest */
+  target = (x == 0 && y == 0)? d->buffer : NULL;
+}
+
+void
+WidgetScreen::update(OLEDDisplay *d)
+{
+  Widget *wd, *other;
+  bool spread;
+
+  if (target == NULL || target != d->buffer) {
+    d->clear();
+    draw(d, 0, 0);
+    return;
+  }
+
+  poll();
+  /* clearing a box erases the part of overlapping widgets in it */
+  do {
+    spread = false;
+    for (wd = widgets; wd < widgets + count; wd++) {
+      if (!wd->dirty)
+        continue;
+      for (other = widgets; other < widgets + count; other++) {
+        if (!other->dirty && overlaps(wd, other)) {
+          other->dirty = true;
+          spread = true;
+        }
+      }
+    }
+  } while (spread);
+
+  for (wd = widgets; wd < widgets + count; wd++)
+    if (wd->dirty)
+      clear_box(d, wd->x, wd->y, wd->w, wd->h);
+  for (wd = widgets; wd < widgets + count; wd++)
+    if (wd->dirty)
+      rasterize(d, wd, 0, 0);
+}
@@ -0,0 +1,124 @@
+/*
+ * WidgetScreen.h - Retained widgets of a frame, redrawn when their data changed
+ *
+ * A screen holds a fixed pool of widgets placed in boxes at setup:
+ * labels, big numbers, icons, progress bars and sparklines, each bound
+ * to a function giving its current value. poll() compares the values
+ * with the ones last drawn, and update() clears and redraws the boxes of
+ * changed widgets only, over what the screen drew in the buffer before.
+ *
+ * Register a screen with OLEDDisplayUiAux::addFrame() to show it as a
+ * frame; it needs no version function, poll() is its version.
+ */
+
+#ifndef __WIDGET_SCREEN_H__
+#define __WIDGET_SCREEN_H__
+
+#include <OLEDDisplay.h>
+#include "NcodeFontDraw.h"
+
+#define WIDGET_MAX  8   /* widgets per screen */
+
+typedef int32_t (*WidgetValueFunction)(void);
+typedef const char *(*WidgetTextFunction)(void);
+
+enum WidgetType {
+  WIDGET_LABEL,
+  WIDGET_BIG_NUMBER,
+  WIDGET_ICON,
+  WIDGET_PROGRESS_BAR,
+  WIDGET_SPARKLINE
+};
+
+struct Widget {
+  uint8_t type;
+  uint8_t align;            /* NcodeFontDraw TEXT_ALIGN_* in box, for text */
+  bool dirty;               /* value changed since drawn */
+  int16_t x, y, w, h;       /* box; drawing stays inside */
+
+  const char *ascii_font;
+  const char *ncode_font;
+  const char *text;         /* label text, or big number format */
+  WidgetTextFunction text_function;
+  WidgetValueFunction value_function;
+
+  int32_t min, max;         /* progress bar range; sparkline range, or auto if min >= max */
+  const char *const *images; /* icon XBM images, all w x h */
+  uint8_t image_count;
+
+  int16_t *samples;         /* sparkline ring buffer */
+  uint8_t sample_size;
+  uint8_t sample_head;      /* next sample slot */
+  uint8_t sample_count;
+  uint32_t sample_serial;   /* samples pushed */
+
+  uint32_t key;             /* drawn value: number, text hash, image index, fill px or serial */
+};
+
+class WidgetScreen {
+private:
+  NcodeFontDraw *nfd;
+  Widget widgets[WIDGET_MAX];
+  uint8_t count;
+  uint32_t version;         /* changed when a widget got dirty */
+  uint8_t *target;          /* buffer holding the last full draw at rest, or NULL */
+  uint32_t raster_count;
+
+  int addWidget(uint8_t type, int x, int y, int w, int h);
+  int textX(Widget *wd);
+  uint32_t keyOf(Widget *wd);
+  void rasterize(OLEDDisplay *d, Widget *wd, int x, int y);
+
+public:
+  WidgetScreen(NcodeFontDraw *_nfd) {
+    nfd = _nfd;
+    count = 0;
+    version = 0;
+    target = NULL;
+    raster_count = 0;
+  }
+
+  /* Add widgets; each returns widget id, or -1 if the pool is full.
+     Text boxes are as high as the font; text must fit in w. */
+
+  /* static text if text_function is NULL */
+  int addLabel(int x, int y, int w, int align,
+               const char *ascii_font, const char *ncode_font,
+               const char *text, WidgetTextFunction text_function = NULL);
+  /* value drawn by a drawf format taking a long, like "CO2: %ld" */
+  int addBigNumber(int x, int y, int w, int align,
+                   const char *ascii_font, const char *ncode_font,
+                   const char *format, WidgetValueFunction value_function);
+  /* XBM image of index value, not drawn if out of range */
+  int addIcon(int x, int y, int w, int h,
+              const char *const *images, uint8_t image_count,
+              WidgetValueFunction value_function);
+  /* frame with fill of value in min ~ max; redrawn when the fill width changes */
+  int addProgressBar(int x, int y, int w, int h, int32_t min, int32_t max,
+                     WidgetValueFunction value_function);
+  /* line of the last sample_size samples pushed, newest at right */
+  int addSparkline(int x, int y, int w, int h, int16_t *samples, uint8_t sample_size,
+                   int32_t min = 0, int32_t max = 0);
+
+  void setText(int id, const char *text);
+  void pushSample(int id, int16_t value);
+  void invalidate(int id);
+
+  /* check bound values; returns a version changed when a widget got dirty */
+  uint32_t poll(void);
+
+  /* draw all widgets offset by x, y over buffer content */
+  void draw(OLEDDisplay *d, int x, int y);
+  /* redraw dirty widgets over the last draw at rest in the same buffer,
+     else clear and draw all */
+  void update(OLEDDisplay *d);
+
+  uint8_t getCount(void) {
+    return count;
+  }
+  uint32_t getRasterCount(void) {
+    return raster_count;
+  }
+};
+
+#endif  /* __WIDGET_SCREEN_H__ */
@@ -0,0 +1,73 @@
+/*
+ * Arduino.cpp - Time and Serial shims for host builds
+ */
+
+#include <time.h>
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+static bool manual_clock = false;
+static unsigned long manual_millis = 0;
+
+static uint64_t
+clockMicros(void)
+{
+  static uint64_t start = 0;
+  struct timespec ts;
+  uint64_t now;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  now = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  if (start == 0)
+    start = now;
+  return now - start;
+}
+
+unsigned long
+millis(void)
+{
+  if (manual_clock)
+    return manual_millis;
+  return (unsigned long) (clockMicros() / 1000);
+}
+
+unsigned long
+micros(void)
+{
+  return (unsigned long) clockMicros();
+}
+
+void
+delay(unsigned long ms)
+{
+  struct timespec ts;
+
+  if (manual_clock) {
+    manual_millis += ms;
+    return;
+  }
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+void
+yield(void)
+{
+}
+
+void
+hostSetMillis(unsigned long ms)
+{
+  manual_clock = true;
+  manual_millis = ms;
+}
+
+void
+hostAdvanceMillis(unsigned long ms)
+{
+  if (!manual_clock)
+    hostSetMillis(millis());
+  manual_millis += ms;
+}
@@ -0,0 +1,175 @@
+/*
+ * Arduino.h - Minimal Arduino core shims to build the rendering stack on a host
+ *
+ * Only what OLEDDisplay, OLEDDisplayUiAux, NcodeFontDraw and the frame code
+ * use: fixed width types, PROGMEM access, time, String and Print.
+ * PROGMEM data is plain memory here.
+ *
+ * millis() follows the host monotonic clock, or a manual clock once
+ * hostSetMillis() is called; then delay() advances it instead of sleeping,
+ * so time driven code runs at full host speed. micros() always follows
+ * the host clock, to measure real run times.
+ */
+
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#ifdef __cplusplus
+#include <string>
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+/* program memory is ordinary memory */
+#define PROGMEM
+#define PGM_P                   const char *
+#define F(s)                    (s)
+#define pgm_read_byte(p)        (*(const uint8_t *)(p))
+#define pgm_read_word(p)        (*(const uint16_t *)(p))
+#define pgm_read_dword(p)       (*(const uint32_t *)(p))
+#define pgm_read_byte_near(p)   pgm_read_byte(p)
+#define pgm_read_word_near(p)   pgm_read_word(p)
+#define memcpy_P                memcpy
+#define strlen_P                strlen
+
+#ifndef _min
+#define _min(a, b)              ((a) < (b) ? (a) : (b))
+#define _max(a, b)              ((a) > (b) ? (a) : (b))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void yield(void);
+
+/* switch millis() to the manual clock at ms, and move it on */
+void hostSetMillis(unsigned long ms);
+void hostAdvanceMillis(unsigned long ms);
+
+#ifdef __cplusplus
+}
+
+inline uint16_t word(uint8_t h, uint8_t l) { return (h << 8) | l; }
+
+class String {
+  private:
+    std::string s;
+
+  public:
+    String(const char *c = "") : s(c ? c : "") {}
+    String(const std::string &str) : s(str) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(double v, unsigned char decimals = 2) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+      s = buf;
+    }
+
+    unsigned int length(void) const { return s.size(); }
+    const char *c_str(void) const { return s.c_str(); }
+    char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    void toCharArray(char *buf, unsigned int size, unsigned int index = 0) const {
+      if (size == 0) return;
+      strncpy(buf, index < s.size() ? s.c_str() + index : "", size - 1);
+      buf[size - 1] = '\0';
+    }
+    String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+      return from < to && from < s.size() ? String(s.substr(from, to - from)) : String();
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+      size_t i = s.find(c, from);
+      return i == std::string::npos ? -1 : (int) i;
+    }
+    int indexOf(const String &str, unsigned int from = 0) const {
+      size_t i = s.find(str.s, from);
+      return i == std::string::npos ? -1 : (int) i;
+    }
+    long toInt(void) const { return atol(s.c_str()); }
+    float toFloat(void) const { return atof(s.c_str()); }
+    void toUpperCase(void) { for (size_t i = 0; i < s.size(); i++) if (s[i] >= 'a' && s[i] <= 'z') s[i] -= 32; }
+    void toLowerCase(void) { for (size_t i = 0; i < s.size(); i++) if (s[i] >= 'A' && s[i] <= 'Z') s[i] += 32; }
+    void trim(void) {
+      size_t b = s.find_first_not_of(" \t\r\n"), e = s.find_last_not_of(" \t\r\n");
+      s = b == std::string::npos ? "" : s.substr(b, e - b + 1);
+    }
+
+    String &operator+=(const String &o) { s += o.s; return *this; }
+    String &operator+=(const char *c) { s += c; return *this; }
+    String &operator+=(char c) { s += c; return *this; }
+    String operator+(const String &o) const { return String(s + o.s); }
+    friend String operator+(const char *a, const String &b) { return String(a) + b; }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *c) const { return s == c; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator!=(const char *c) const { return s != c; }
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t n = 0;
+      while (size--) n += write(*buffer++);
+      return n;
+    }
+    size_t write(const char *str) {
+      return str ? write((const uint8_t *) str, strlen(str)) : 0;
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+      char buf[256];
+      va_list ap;
+      va_start(ap, format);
+      int len = vsnprintf(buf, sizeof(buf), format, ap);
+      va_end(ap);
+      if (len < 0) return 0;
+      return write((const uint8_t *) buf, (size_t) len < sizeof(buf) ? len : sizeof(buf) - 1);
+    }
+    size_t print(const char *str) { return write(str); }
+    size_t print(const String &str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(long n) { return printf("%ld", n); }
+    size_t print(int n) { return print((long) n); }
+    size_t print(unsigned long n) { return printf("%lu", n); }
+    size_t print(unsigned int n) { return print((unsigned long) n); }
+    size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+    size_t println(void) { return write("\r\n"); }
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+};
+
+/* Serial prints to stdout */
+class HardwareSerial : public Print {
+  public:
+    void begin(unsigned long baud) { (void) baud; }
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    void flush(void) { fflush(stdout); }
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif  /* __cplusplus */
+
+#endif  /* __HOST_ARDUINO_H__ */
@@ -0,0 +1,304 @@
+/*
+ * HeadlessDisplay.cpp - OLEDDisplay rendering into memory for host runs
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "HeadlessDisplay.h"
+
+/* I2C bits: 9 per byte with ack; each command is a transmission of
+   address, control and command bytes, data goes 16 bytes per
+   transmission after address and control bytes, as SSD1306WireAux does */
+#define BUS_COMMAND_BITS(n)   ((uint32_t) (n) * 3 * 9)
+#define BUS_DATA_BITS(n)      (((uint32_t) (n) + ((n) + 15) / 16 * 2) * 9)
+
+
+HeadlessDisplay::HeadlessDisplay()
+{
+  memset(this->panel, 0, sizeof(this->panel));
+  memset(this->changed, 0, sizeof(this->changed));
+}
+
+HeadlessDisplay::~HeadlessDisplay()
+{
+  if (this->busThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(this->busLock);
+      this->busStop = true;
+    }
+    this->busWake.notify_all();
+    this->busThread.join();
+  }
+}
+
+void
+HeadlessDisplay::setBusRate(uint32_t bitsPerSecond, bool simulated)
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  this->busRate = bitsPerSecond;
+  this->busSimulated = simulated;
+  this->busFreeUs = (uint64_t) millis() * 1000;
+}
+
+void
+HeadlessDisplay::sendCommand(uint8_t command)
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  (void) command;
+  this->commandBytes++;
+}
+
+void
+HeadlessDisplay::sendWindow(uint8_t page, uint8_t x0, uint8_t x1, const uint8_t *data)
+  /* land data of columns x0..x1 on the panel; called with busLock held */
+{
+  uint8_t *out = this->panel + page * DISPLAY_WIDTH;
+  int x;
+
+  for (x = x0; x <= x1; x++) {
+    this->changed[page * DISPLAY_WIDTH + x] |= out[x] ^ data[x - x0];
+    out[x] = data[x - x0];
+  }
+  this->dataBytes += x1 - x0 + 1;
+}
+
+void
+HeadlessDisplay::busSleep(uint32_t bits)
+{
+  uint64_t ns, now;
+  struct timespec ts;
+
+  if (this->busRate == 0)
+    return;
+  if (this->busSimulated) {
+    /* on the manual clock, carrying the part of a ms over */
+    now = (uint64_t) millis() * 1000;
+    if (this->busFreeUs < now)
+      this->busFreeUs = now;
+    this->busFreeUs += (uint64_t) bits * 1000000 / this->busRate;
+    delay((this->busFreeUs - now) / 1000);
+    return;
+  }
+  ns = (uint64_t) bits * 1000000000 / this->busRate;
+  ts.tv_sec = ns / 1000000000;
+  ts.tv_nsec = ns % 1000000000;
+  nanosleep(&ts, NULL);
+}
+
+void
+HeadlessDisplay::display(void)
+{
+  if (this->buffer == NULL)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(this->busLock);
+    /* one window of all columns and pages, as SSD1306Wire sends it */
+    for (uint8_t page = 0; page < DISPLAY_HEIGHT / 8; page++)
+      this->sendWindow(page, 0, DISPLAY_WIDTH - 1, this->buffer + page * DISPLAY_WIDTH);
+    this->commandBytes += HEADLESS_WINDOW_COMMANDS;
+    this->flushCount++;
+  }
+  this->busSleep(BUS_COMMAND_BITS(HEADLESS_WINDOW_COMMANDS) + BUS_DATA_BITS(DISPLAY_BUFFER_SIZE));
+}
+
+void
+HeadlessDisplay::displayWindow(uint8_t page, uint8_t x0, uint8_t x1)
+{
+  if (this->buffer == NULL || page >= DISPLAY_HEIGHT / 8 || x0 > x1 || x1 >= DISPLAY_WIDTH)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(this->busLock);
+    this->sendWindow(page, x0, x1, this->buffer + page * DISPLAY_WIDTH + x0);
+    this->commandBytes += HEADLESS_WINDOW_COMMANDS;
+    this->windowCount++;
+  }
+  this->busSleep(BUS_COMMAND_BITS(HEADLESS_WINDOW_COMMANDS) + BUS_DATA_BITS(x1 - x0 + 1));
+}
+
+bool
+HeadlessDisplay::sendChunk(const FlushChunk *chunk)
+{
+  BusChunk *entry;
+
+  if (chunk->page >= DISPLAY_HEIGHT / 8 || chunk->length == 0 ||
+      chunk->length > HEADLESS_CHUNK_MAX || chunk->x + chunk->length > DISPLAY_WIDTH)
+    return true;  /* nothing to send */
+
+  std::unique_lock<std::mutex> guard(this->busLock);
+  if (this->busSimulated && this->busRate > 0) {
+    /* taken while less than 1 ms is queued ahead of the clock */
+    uint64_t now = (uint64_t) millis() * 1000;
+    uint32_t bits = BUS_DATA_BITS(chunk->length);
+
+    if (this->busFreeUs < now)
+      this->busFreeUs = now;
+    if (this->busFreeUs - now >= 1000)
+      return false;
+    if (chunk->x == chunk->x0)
+      bits += BUS_COMMAND_BITS(HEADLESS_WINDOW_COMMANDS);
+    this->busFreeUs += (uint64_t) bits * 1000000 / this->busRate;
+  }
+  if (this->busRate == 0 || this->busSimulated) {
+    /* instant or simulated bus: on the panel at once */
+    this->sendWindow(chunk->page, chunk->x, chunk->x + chunk->length - 1, chunk->data);
+    if (chunk->x == chunk->x0) {
+      this->commandBytes += HEADLESS_WINDOW_COMMANDS;
+      this->windowCount++;
+    }
+    return true;
+  }
+  if (this->busCount == HEADLESS_BUS_QUEUE)
+    return false;
+
+  entry = &this->busQueue[(this->busHead + this->busCount) % HEADLESS_BUS_QUEUE];
+  entry->chunk = *chunk;
+  memcpy(entry->data, chunk->data, chunk->length);
+  entry->chunk.data = entry->data;
+  this->busCount++;
+  if (!this->busThread.joinable())
+    this->busThread = std::thread(&HeadlessDisplay::busRun, this);
+  guard.unlock();
+  this->busWake.notify_one();
+  return true;
+}
+
+void
+HeadlessDisplay::busRun()
+  /* bus thread: send queued chunks in order, each landing when sent */
+{
+  std::unique_lock<std::mutex> guard(this->busLock);
+  FlushChunk chunk;
+  uint32_t bits;
+
+  for (;;) {
+    this->busWake.wait(guard, [this] { return this->busStop || this->busCount > 0; });
+    if (this->busStop)
+      return;
+
+    chunk = this->busQueue[this->busHead].chunk;
+    bits = BUS_DATA_BITS(chunk.length);
+    if (chunk.x == chunk.x0)
+      bits += BUS_COMMAND_BITS(HEADLESS_WINDOW_COMMANDS);
+    guard.unlock();
+    this->busSleep(bits);
+    guard.lock();
+
+    this->sendWindow(chunk.page, chunk.x, chunk.x + chunk.length - 1, chunk.data);
+    if (chunk.x == chunk.x0) {
+      this->commandBytes += HEADLESS_WINDOW_COMMANDS;
+      this->windowCount++;
+    }
+    this->busHead = (this->busHead + 1) % HEADLESS_BUS_QUEUE;
+    this->busCount--;
+  }
+}
+
+bool
+HeadlessDisplay::isBusIdle()
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  if (this->busSimulated)
+    return this->busFreeUs <= (uint64_t) millis() * 1000;
+  return this->busCount == 0;
+}
+
+bool
+HeadlessDisplay::pixel(const uint8_t *buffer, int16_t x, int16_t y)
+{
+  if (x < 0 || x >= DISPLAY_WIDTH || y < 0 || y >= DISPLAY_HEIGHT)
+    return false;
+  return (buffer[x + (y >> 3) * DISPLAY_WIDTH] >> (y & 7)) & 1;
+}
+
+bool
+HeadlessDisplay::getPanelPixel(int16_t x, int16_t y)
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  return pixel(this->panel, x, y);
+}
+
+uint32_t
+HeadlessDisplay::getFlushCount()
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  return this->flushCount;
+}
+
+uint32_t
+HeadlessDisplay::getWindowCount()
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  return this->windowCount;
+}
+
+uint32_t
+HeadlessDisplay::getDataBytes()
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  return this->dataBytes;
+}
+
+uint32_t
+HeadlessDisplay::getCommandBytes()
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  return this->commandBytes;
+}
+
+void
+HeadlessDisplay::resetCounters()
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  this->flushCount = 0;
+  this->windowCount = 0;
+  this->dataBytes = 0;
+  this->commandBytes = 0;
+}
+
+bool
+HeadlessDisplay::dumpPBM(const char *path)
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  FILE *fp = fopen(path, "wb");
+  int x, y;
+
+  if (fp == NULL)
+    return false;
+  fprintf(fp, "P4\n%d %d\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  /* rows of 8 pixels per byte, msb first */
+  for (y = 0; y < DISPLAY_HEIGHT; y++) {
+    for (x = 0; x < DISPLAY_WIDTH; x += 8) {
+      uint8_t b = 0;
+      for (int i = 0; i < 8; i++)
+        b |= pixel(this->panel, x + i, y) << (7 - i);
+      fputc(b, fp);
+    }
+  }
+  return fclose(fp) == 0;
+}
+
+bool
+HeadlessDisplay::dumpPGM(const char *path, uint8_t scale)
+{
+  std::lock_guard<std::mutex> guard(this->busLock);
+  FILE *fp = fopen(path, "wb");
+  int x, y, i;
+
+  if (fp == NULL)
+    return false;
+  if (scale == 0)
+    scale = 1;
+  fprintf(fp, "P5\n%d %d\n255\n", DISPLAY_WIDTH * scale, DISPLAY_HEIGHT * scale);
+  for (y = 0; y < DISPLAY_HEIGHT * scale; y++) {
+    for (x = 0; x < DISPLAY_WIDTH * scale; x++) {
+      int px = x / scale, py = y / scale;
+      bool lit = pixel(this->panel, px, py);
+      bool flipped = pixel(this->changed, px, py);
+      fputc(flipped ? (lit ? 192 : 96) : (lit ? 255 : 0), fp);
+    }
+  }
+  for (i = 0; i < DISPLAY_BUFFER_SIZE; i++)
+    this->changed[i] = 0;
+  return fclose(fp) == 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * HeadlessDisplay.h - OLEDDisplay rendering into memory for host runs
+ *
+ * The panel is an in-memory 128x64 copy of what display() or
+ * displayWindow() sent, with counts of flushes and bytes as they would
+ * go over the bus. Panel frames can be dumped as PBM or PGM images.
+ *
+ * With a bus rate set, transfers take the time they would over I2C:
+ * display() and displayWindow() block for it like Wire does, while
+ * chunks of the asynchronous flush queue up for a bus thread that lands
+ * them on the panel as they are sent.
+ *
+ * A simulated bus runs on the manual millis() clock instead: blocking
+ * transfers advance it, and chunks are taken while less than 1 ms of
+ * them is ahead of the clock, landing on the panel when taken.
+ */
+
+#ifndef HEADLESSDISPLAY_h
+#define HEADLESSDISPLAY_h
+
+#include <OLEDDisplay.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "OLEDDisplayUiAux.h"
+
+// Command bytes of a window: COLUMNADDR, PAGEADDR and their args
+#define HEADLESS_WINDOW_COMMANDS 6
+
+// Chunks queued for the bus thread, and their max data bytes
+#define HEADLESS_BUS_QUEUE       8
+#define HEADLESS_CHUNK_MAX       32
+
+class HeadlessDisplay : public OLEDDisplay {
+  private:
+    uint8_t             panel[DISPLAY_BUFFER_SIZE];
+    uint8_t             changed[DISPLAY_BUFFER_SIZE];   // pixels flipped since the last dump
+
+    uint32_t            flushCount                = 0;
+    uint32_t            windowCount               = 0;
+    uint32_t            dataBytes                 = 0;
+    uint32_t            commandBytes              = 0;
+
+    // Simulated bus, panel and counters are shared with its thread
+    struct BusChunk {
+      FlushChunk        chunk;
+      uint8_t           data[HEADLESS_CHUNK_MAX];
+    };
+    uint32_t            busRate                   = 0;  // bits per second, 0 for instant
+    bool                busSimulated              = false;
+    uint64_t            busFreeUs                 = 0;  // simulated bus busy until, us of millis()
+    BusChunk            busQueue[HEADLESS_BUS_QUEUE];
+    uint8_t             busHead                   = 0;
+    uint8_t             busCount                  = 0;  // head stays queued until on the panel
+    bool                busStop                   = false;
+    std::thread         busThread;
+    std::mutex          busLock;
+    std::condition_variable busWake;
+
+    void                sendWindow(uint8_t page, uint8_t x0, uint8_t x1, const uint8_t *data);
+    void                busSleep(uint32_t bits);
+    void                busRun();
+    static bool         pixel(const uint8_t *buffer, int16_t x, int16_t y);
+
+  protected:
+    bool connect() {
+      return true;
+    }
+    void sendCommand(uint8_t command);
+
+  public:
+    HeadlessDisplay();
+    ~HeadlessDisplay();
+
+    /**
+     * Set bus speed in bits per second, 0 for instant transfers;
+     * simulated on the manual millis() clock, or in real time
+     */
+    void setBusRate(uint32_t bitsPerSecond, bool simulated = false);
+
+    /**
+     * Send the whole buffer to the panel
+     */
+    void display(void);
+
+    /**
+     * Send columns x0..x1 of page only, like SSD1306WireAux
+     */
+    void displayWindow(uint8_t page, uint8_t x0, uint8_t x1);
+
+    /**
+     * Queue a chunk for the bus; false if the queue is full
+     */
+    bool sendChunk(const FlushChunk *chunk);
+    bool isBusIdle();
+
+    /**
+     * FlushCallback for OLEDDisplayUiAux::setFlushFunction()
+     */
+    static void flushWindow(OLEDDisplay *display, uint8_t page, uint8_t x0, uint8_t x1) {
+      static_cast<HeadlessDisplay *>(display)->displayWindow(page, x0, x1);
+    }
+
+    /**
+     * FlushChunkCallback for OLEDDisplayUiAux::setAsyncFlush()
+     */
+    static bool flushChunk(OLEDDisplay *display, const FlushChunk *chunk) {
+      return static_cast<HeadlessDisplay *>(display)->sendChunk(chunk);
+    }
+
+    /**
+     * Panel content, in OLEDDisplay buffer layout; stable while the bus is idle
+     */
+    const uint8_t *getPanel() {
+      return this->panel;
+    }
+    bool getPanelPixel(int16_t x, int16_t y);
+
+    /**
+     * display() calls, page windows sent, and bytes sent to the panel
+     * including init commands
+     */
+    uint32_t getFlushCount();
+    uint32_t getWindowCount();
+    uint32_t getDataBytes();
+    uint32_t getCommandBytes();
+    void resetCounters();
+
+    /**
+     * Write panel as binary PBM, 1 for lit pixels.
+     * Returns false if the file could not be written.
+     */
+    bool dumpPBM(const char *path);
+
+    /**
+     * Write panel as binary PGM scaled up by scale: lit pixels white,
+     * pixels changed since the last dump grey, lighter if lit.
+     */
+    bool dumpPGM(const char *path, uint8_t scale = 1);
+};
+
+#endif
@@ -0,0 +1,10 @@
+/*
+ * pgmspace.h - PROGMEM shims for host builds, see Arduino.h
+ */
+
+#ifndef __HOST_PGMSPACE_H__
+#define __HOST_PGMSPACE_H__
+
+#include "Arduino.h"
+
+#endif  /* __HOST_PGMSPACE_H__ */
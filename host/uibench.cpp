@@ -0,0 +1,245 @@
+/*
+ * uibench.cpp - Run OLEDDisplayUiAux with sample frames on HeadlessDisplay
+ *
+ * Simulated time runs on the manual millis() clock, so a run of minutes
+ * takes well under a second. Prints flush counts and bytes, host time
+ * per update, and the callback profile when built with PROFILE=1.
+ *
+ * With a bus rate, the run is in real time with transfers taking bus
+ * time; compare ui.update() times with and without -a to see the gain
+ * of draining the flush while the loop goes on. A limited bus takes bus
+ * time on the simulated clock instead, so frames are composed while
+ * the previous one is still draining; the time the panel stays behind
+ * the last composed frame with nothing left to send is printed, and
+ * should be 0.
+ *
+ * The wait between updates goes through IdleManager as loop() does, so
+ * its stats tell how much of the run could be spent in light sleep.
+ *
+ *   uibench [-t seconds] [-d dir] [-s scale] [-b bits/s | -l bits/s] [-a]
+ *     -t  run time, default 60
+ *     -d  dump panel after each update that sent bytes, as dir/NNNNNNN.pgm
+ *         named by millis(), and the last panel as dir/last.pbm
+ *     -s  PGM scale, default 2
+ *     -b  bus rate, ie. 400000 for I2C fast mode; runs in real time
+ *     -l  limited bus rate on the simulated clock, ie. 100000
+ *     -a  asynchronous flush
+ */
+
+#include <Arduino.h>
+#include <unistd.h>
+#include "HeadlessDisplay.h"
+#include "OLEDDisplayUiAux.h"
+#include "NcodeFontDraw.h"
+#include "NcodeMarquee.h"
+#include "WidgetScreen.h"
+#include "IdleManager.h"
+#include "HelveticaFont.h"
+#include "NewPinetreeFont.h"
+
+HeadlessDisplay display;
+OLEDDisplayUiAux ui(&display);
+NcodeFontDraw nfd(Helvetica_18, NewPinetree_18, 1);
+NcodeMarquee marquee(&nfd);
+WidgetScreen sensors(&nfd);
+// sleeping is a delay here, on the manual clock when simulated
+IdleManager idle(delay);
+
+// Clock from boot, ticking seconds
+void drawClock(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+  unsigned long secs = millis() / 1000;
+  nfd.setFont(Helvetica_24, NewPinetree_24);
+  nfd.drawf(display, 64 + x, 10 + y, nfd.TEXT_ALIGN_CENTER, "%02lu:%02lu:%02lu",
+            secs / 3600 % 24, secs / 60 % 60, secs % 60);
+  nfd.setFont(Helvetica_14, NewPinetree_14);
+  nfd.drawString(display, 64 + x, 40 + y, nfd.TEXT_ALIGN_CENTER, "2017.5.10 (수)");
+}
+
+uint32_t versionClock(int frameIndex, int frameCount) {
+  ui.scheduleUpdate(1000 - millis() % 1000);  // roll seconds on time
+  return millis() / 1000;
+}
+
+// Static hangul text
+void drawText(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+  nfd.setFont(Helvetica_18, NewPinetree_18);
+  nfd.drawStringMaxWidth(display, 64 + x, 4 + y, nfd.TEXT_ALIGN_CENTER, 128, "안녕하세요 TinyStation");
+}
+
+uint32_t versionText(int frameIndex, int frameCount) {
+  return 0;
+}
+
+// Bars changing every 2 seconds
+void drawBars(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+  uint32_t seed = millis() / 2000 * 2654435761u;
+  for (int i = 0; i < 8; i++) {
+    int h = 8 + (seed >> (i * 3) & 31);
+    for (int j = 0; j < h; j++)
+      for (int k = 0; k < 12; k++)
+        display->setPixel(x + 4 + i * 15 + k, y + 54 - j);
+  }
+}
+
+uint32_t versionBars(int frameIndex, int frameCount) {
+  return millis() / 2000;
+}
+
+// Sensor widgets: reading changing every 3 seconds, with its history
+int16_t sensorSamples[32];
+int sensorSparkline;
+
+int32_t valueSensor(void) {
+  return 400 + (millis() / 3000 * 2654435761u >> 20) % 1600;
+}
+
+unsigned long lastSample = 0;
+
+void sampleSensor(void) {
+  if (millis() - lastSample >= 3000) {
+    lastSample = millis();
+    sensors.pushSample(sensorSparkline, valueSensor());
+  }
+}
+
+// Deadlines of the idle wait: ui update and the sensor poll
+long deadlineUi(void) {
+  long t = ui.getTimeToUpdate();
+  return t > 0 ? t : 0;
+}
+
+long deadlineSensor(void) {
+  long t = 3000 - (long) (millis() - lastSample);
+  return t > 0 ? t : 0;
+}
+
+// Scrolling message, drawn each update
+void drawMarquee(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+  nfd.setFont(Helvetica_12, NewPinetree_12);
+  nfd.drawString(display, 64 + x, 2 + y, nfd.TEXT_ALIGN_CENTER, "MQTT Message");
+  marquee.draw(display, x, 24 + y);
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 60;
+  const char *dir = NULL;
+  uint8_t scale = 2;
+  uint32_t busRate = 0;
+  bool simulated = true;
+  bool async = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:d:s:b:l:a")) != -1) {
+    switch (opt) {
+      case 't': seconds = strtoul(optarg, NULL, 10); break;
+      case 'd': dir = optarg; break;
+      case 's': scale = atoi(optarg); break;
+      case 'b': busRate = strtoul(optarg, NULL, 10); simulated = false; break;
+      case 'l': busRate = strtoul(optarg, NULL, 10); simulated = true; break;
+      case 'a': async = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-t seconds] [-d dir] [-s scale] [-b bits/s | -l bits/s] [-a]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (simulated)
+    hostSetMillis(0);
+  display.setBusRate(busRate, simulated);
+  ui.setTargetFPS(30);
+  ui.setTimePerFrame(5000);
+  ui.setTimePerTransition(500);
+  if (async)
+    ui.setAsyncFlush(HeadlessDisplay::flushChunk);
+  else
+    ui.setFlushFunction(HeadlessDisplay::flushWindow);
+
+  int8_t frame = ui.addFrame(drawClock);
+  ui.setFrameVersion(frame, versionClock);
+  ui.setFrameInterval(frame, 1000);
+  ui.setLiveFrame(frame, true);
+  frame = ui.addFrame(drawText);
+  ui.setFrameVersion(frame, versionText);
+  ui.setFrameInterval(frame, 5000);
+  frame = ui.addFrame(drawBars);
+  ui.setFrameVersion(frame, versionBars);
+  ui.setFrameInterval(frame, 1000);
+  ui.addFrame(drawMarquee);
+  sensors.addBigNumber(0, 0, 128, nfd.TEXT_ALIGN_CENTER, Helvetica_Bold_24, NewPinetree_Bold_24,
+                       "CO2: %ld", valueSensor);
+  sensors.addProgressBar(4, 30, 120, 6, 400, 2000, valueSensor);
+  sensorSparkline = sensors.addSparkline(4, 40, 120, 14, sensorSamples, 32);
+  frame = ui.addFrame(&sensors);
+  ui.setFrameInterval(frame, 1000);
+  marquee.setText(Helvetica_18, NewPinetree_18, "호스트에서 화면을 그려 봅니다 - rendering on the host at full speed");
+
+  idle.addDeadline(deadlineUi);
+  idle.addDeadline(deadlineSensor);
+
+  ui.init();
+  display.resetCounters();
+  idle.resetStats();
+
+  unsigned long updates = 0, drawn = 0, hostTime = 0, maxTime = 0, behind = 0;
+  unsigned long end = millis() + seconds * 1000;
+  while ((long) (millis() - end) < 0) {
+    uint32_t bytes = display.getDataBytes();
+    sampleSensor();
+    unsigned long start = micros();
+    long wait = ui.update();
+    unsigned long time = micros() - start;
+    hostTime += time;
+    if (time > maxTime) maxTime = time;
+    updates++;
+
+    // Chunks left go out in the wait, as loop() does, until on the panel
+    unsigned long waitStart = millis();
+    while ((ui.isFlushBusy() || !display.isBusIdle()) && (long) (millis() - waitStart) < wait) {
+      if (ui.pumpFlush() || !display.isBusIdle()) delay(1);
+    }
+    wait -= millis() - waitStart;
+
+    if (display.getDataBytes() != bytes) {
+      drawn++;
+      if (dir) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%07lu.pgm", dir, millis());
+        if (!display.dumpPGM(path, scale)) {
+          perror(path);
+          return 1;
+        }
+      }
+    }
+    // Panel not showing the frame with the flush done is stale until the
+    // next update
+    bool stale = !ui.isFlushBusy() && display.isBusIdle() &&
+                 memcmp(display.getPanel(), display.buffer, DISPLAY_BUFFER_SIZE) != 0;
+    unsigned long waited = idle.wait(wait);
+    if (waited == 0) {
+      delay(1);
+      waited = 1;
+    }
+    if (stale)
+      behind += waited;
+  }
+  if (dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/last.pbm", dir);
+    display.dumpPBM(path);
+  }
+
+  Serial.printf("%s %lu s: %lu updates, %lu sent, %lu us host time per update, max %lu us\n",
+                simulated ? "simulated" : "ran", seconds, updates, drawn,
+                updates ? hostTime / updates : 0, maxTime);
+  Serial.printf("display() %u, windows %u, data %u bytes, commands %u bytes, %u bytes/s\n",
+                display.getFlushCount(), display.getWindowCount(), display.getDataBytes(),
+                display.getCommandBytes(),
+                (uint32_t) ((display.getDataBytes() + display.getCommandBytes()) / (seconds ? seconds : 1)));
+  Serial.printf("marquee renders %u, widget renders %u\n", marquee.getRenderCount(), sensors.getRasterCount());
+  Serial.printf("panel behind the last frame %lu ms\n", behind);
+  idle.printStats(&Serial);
+#ifdef OLEDDISPLAYUI_PROFILE
+  ui.printProfile(&Serial);
+#endif
+  return 0;
+}
@@ -13,228 +13,429 @@
 
 #define FONT_HEIGHT  14
 
+/*
+ * Glyphs are kept transposed in SSD1306 page order: each column of the
+ * glyph's used rows (top .. top + height - 1) is stored as 1 byte (height
+ * <= 8) or 2 bytes (low byte first), bit 0 being the top row. Empty
+ * columns on the left are trimmed away and accounted in xoff, so a glyph
+ * costs 7 bytes of header plus width * ((height + 7) / 8) bytes of bitmap
+ * instead of the 32 bytes of the row image table.
+ */
 typedef struct {
-  uint8_t start;
-  uint8_t end;
-  uint8_t top_bound;
-  uint8_t bottom_bound;
-  unsigned short image[FONT_HEIGHT];
+  int8_t  xoff;         /* first stored column relative to pen x */
+  uint8_t advance;      /* pen advance; was end - start */
+  uint8_t top;          /* first used row */
+  uint8_t height;       /* number of used rows; 0 for blank glyphs */
+  uint8_t width;        /* number of stored columns */
+  uint8_t offset_b1;    /* offset into font_columns[] */
+  uint8_t offset_b0;
 } font_item;
 
 const font_item font_data[] PROGMEM = {
+/* xoff, advance, top, height, width, offset_b1, offset_b0 */
 /* Pinetree (Narae Bitmap Font) */
 /* ascii font: 0x20 - 0x7f */
-//0x00
-{ 0,4,13,0, {0} },
-{ 0,3,1,10, {0,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0,0xc000,0xc000} },
-{ 0,6,0,2, {0xd800,0xd800,0x9000} },
-{ 0,8,3,8, {0,0,0,0x6c00,0xfe00,0x6c00,0x6c00,0xfe00,0x6c00} },
-{ 0,6,2,10, {0,0,0x2000,0x7000,0xa800,0xa000,0x7000,0x2800,0xa800,0x7000,0x2000} },
-{ 0,6,3,8, {0,0,0,0xc800,0xd800,0x3000,0x6000,0xd800,0x9800} },
-{ 0,8,2,9, {0,0,0x7000,0xd800,0xd800,0x7000,0x7e00,0xcc00,0xde00,0x7200} },
-{ 0,3,0,2, {0xc000,0xc000,0x8000} },
-{ 0,5,2,9, {0,0,0x3000,0x6000,0xc000,0xc000,0xc000,0xc000,0x6000,0x3000} },
-{ 0,5,2,9, {0,0,0xc000,0x6000,0x3000,0x3000,0x3000,0x3000,0x6000,0xc000} },
-{ 0,8,4,8, {0,0,0,0,0x6c00,0x3800,0xfe00,0x3800,0x6c00} },
-{ 0,7,3,8, {0,0,0,0x3000,0x3000,0xfc00,0xfc00,0x3000,0x3000} },
-{ 0,3,9,11, {0,0,0,0,0,0,0,0,0,0xc000,0xc000,0x8000} },
-{ 0,6,5,6, {0,0,0,0,0,0xf800,0xf800} },
-{ 0,3,9,10, {0,0,0,0,0,0,0,0,0,0xc000,0xc000} },
-{ 0,6,2,9, {0,0,0x1800,0x1800,0x3000,0x3000,0x6000,0x6000,0xc000,0xc000} },
-//0x10
-{ 0,7,3,9, {0,0,0,0x7800,0xcc00,0xcc00,0xcc00,0xcc00,0xcc00,0x7800} },
-{ 0,5,2,9, {0,0,0x6000,0xe000,0x6000,0x6000,0x6000,0x6000,0x6000,0xf000} },
-{ 0,7,2,9, {0,0,0x7800,0xcc00,0xcc00,0xc00,0x1800,0x3000,0x6400,0xfc00} },
-{ 0,7,2,9, {0,0,0x7800,0xcc00,0xcc00,0x1800,0xc00,0xcc00,0xcc00,0x7800} },
-{ 0,7,2,9, {0,0,0x800,0x1800,0x3800,0x7800,0xd800,0xfc00,0x1800,0x3c00} },
-{ 0,7,2,9, {0,0,0xfc00,0xc000,0xc000,0xf800,0xc00,0xc00,0xcc00,0x7800} },
-{ 0,7,2,9, {0,0,0x3800,0x6000,0xc000,0xf800,0xcc00,0xcc00,0xcc00,0x7800} },
-{ 0,7,2,9, {0,0,0xfc00,0xcc00,0xc00,0x1800,0x1800,0x3000,0x3000,0x3000} },
-{ 0,7,2,9, {0,0,0x7800,0xcc00,0xcc00,0x7800,0xcc00,0xcc00,0xcc00,0x7800} },
-{ 0,7,2,9, {0,0,0x7800,0xcc00,0xcc00,0xcc00,0x7c00,0xc00,0x1800,0x7000} },
-{ 0,3,3,8, {0,0,0,0xc000,0xc000,0,0,0xc000,0xc000} },
-{ 0,3,3,9, {0,0,0,0xc000,0xc000,0,0,0xc000,0xc000,0x8000} },
-{ 0,6,2,9, {0,0,0x1800,0x3000,0x6000,0xc000,0xc000,0x6000,0x3000,0x1800} },
-{ 0,6,3,7, {0,0,0,0xf800,0xf800,0,0xf800,0xf800} },
-{ 0,6,2,9, {0,0,0xc000,0x6000,0x3000,0x1800,0x1800,0x3000,0x6000,0xc000} },
-{ 0,7,1,10, {0,0x7800,0xcc00,0xcc00,0xc00,0x1800,0x3000,0x3000,0,0x3000,0x3000} },
-//0x20
-{ 0,8,3,9, {0,0,0,0x3800,0x4400,0x9a00,0xaa00,0xbe00,0x4400,0x3800} },
-{ 0,8,1,9, {0,0x1000,0x3800,0x6c00,0xc600,0xc600,0xfe00,0xc600,0xc600,0xc600} },
-{ 0,8,1,9, {0,0xfc00,0xc600,0xc600,0xc600,0xfc00,0xc600,0xc600,0xc600,0xfc00} },
-{ 0,8,1,9, {0,0x3c00,0x6600,0xc200,0xc000,0xc000,0xc000,0xc200,0x6600,0x3c00} },
-{ 0,8,1,9, {0,0xf800,0xcc00,0xc600,0xc600,0xc600,0xc600,0xc600,0xcc00,0xf800} },
-{ 0,7,1,9, {0,0xfc00,0xc000,0xc000,0xc000,0xf800,0xc000,0xc000,0xc000,0xfc00} },
-{ 0,7,1,9, {0,0xfc00,0xc000,0xc000,0xc000,0xf800,0xc000,0xc000,0xc000,0xc000} },
-{ 0,8,1,9, {0,0x3c00,0x6600,0xc200,0xc000,0xc000,0xce00,0xc600,0x6600,0x3e00} },
-{ 0,8,1,9, {0,0xc600,0xc600,0xc600,0xc600,0xfe00,0xc600,0xc600,0xc600,0xc600} },
-{ 0,3,1,9, {0,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000} },
-{ 0,7,1,9, {0,0xc00,0xc00,0xc00,0xc00,0xc00,0xc00,0xcc00,0xcc00,0x7800} },
-{ 0,8,1,9, {0,0xc600,0xcc00,0xd800,0xf000,0xe000,0xf000,0xd800,0xcc00,0xc600} },
-{ 0,7,1,9, {0,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xfc00} },
-{ 0,9,1,9, {0,0xc300,0xe700,0xff00,0xdb00,0xdb00,0xc300,0xc300,0xc300,0xc300} },
-{ 0,8,1,9, {0,0xc600,0xc600,0xe600,0xf600,0xde00,0xce00,0xc600,0xc600,0xc600} },
-{ 0,9,1,9, {0,0x3c00,0x6600,0xc300,0xc300,0xc300,0xc300,0xc300,0x6600,0x3c00} },
-//0x30
-{ 0,8,1,9, {0,0xfc00,0xc600,0xc600,0xc600,0xfc00,0xc000,0xc000,0xc000,0xc000} },
-{ 0,9,1,9, {0,0x3c00,0x6600,0xc300,0xc300,0xc300,0xc300,0xdf00,0x6600,0x3f00} },
-{ 0,8,1,9, {0,0xfc00,0xc600,0xc600,0xc600,0xfc00,0xf000,0xd800,0xcc00,0xc600} },
-{ 0,7,1,9, {0,0x7800,0xcc00,0xc400,0xe000,0x7800,0x1c00,0x8c00,0xcc00,0x7800} },
-{ 0,7,1,9, {0,0xfc00,0x3000,0x3000,0x3000,0x3000,0x3000,0x3000,0x3000,0x3000} },
-{ 0,8,1,9, {0,0xc600,0xc600,0xc600,0xc600,0xc600,0xc600,0xc600,0xc600,0x7c00} },
-{ 0,8,1,9, {0,0xc600,0xc600,0xc600,0xc600,0xc600,0x6c00,0x6c00,0x3800,0x1000} },
-{ 0,9,1,9, {0,0xc300,0xc300,0xc300,0xc300,0xdb00,0xdb00,0xff00,0xe700,0xc300} },
-{ 0,8,1,9, {0,0xc600,0xc600,0x6c00,0x3800,0x1000,0x3800,0x6c00,0xc600,0xc600} },
-{ 0,9,1,9, {0,0xc300,0xc300,0x6600,0x3c00,0x1800,0x1800,0x1800,0x1800,0x1800} },
-{ 0,7,1,9, {0,0xfc00,0xc00,0xc00,0x1800,0x3000,0x6000,0xc000,0xc000,0xfc00} },
-{ 0,5,2,9, {0,0,0xf000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xf000} },
-{ 0,6,2,9, {0,0,0xc000,0xc000,0x6000,0x6000,0x3000,0x3000,0x1800,0x1800} },
-{ 0,5,2,9, {0,0,0xf000,0x3000,0x3000,0x3000,0x3000,0x3000,0x3000,0xf000} },
-{ 0,6,0,2, {0x2000,0x7000,0xd800} },
-{ 0,6,11,12, {0,0,0,0,0,0,0,0,0,0,0,0xf800,0xf800} },
-//0x40
-{ 0,3,0,2, {0xc000,0xc000,0x4000} },
-{ 0,7,4,9, {0,0,0,0,0x7800,0xc00,0x7c00,0xcc00,0xcc00,0x7c00} },
-{ 0,7,1,9, {0,0xc000,0xc000,0xc000,0xf800,0xcc00,0xcc00,0xcc00,0xcc00,0xf800} },
-{ 0,7,4,9, {0,0,0,0,0x7800,0xcc00,0xc000,0xc000,0xcc00,0x7800} },
-{ 0,7,1,9, {0,0xc00,0xc00,0xc00,0x7c00,0xcc00,0xcc00,0xcc00,0xcc00,0x7c00} },
-{ 0,7,4,9, {0,0,0,0,0x7800,0xcc00,0xfc00,0xc000,0xcc00,0x7800} },
-{ 0,6,1,9, {0,0x3800,0x6000,0x6000,0xf800,0x6000,0x6000,0x6000,0x6000,0x6000} },
-{ 0,7,4,11, {0,0,0,0,0x7c00,0xcc00,0xcc00,0xcc00,0xcc00,0x7c00,0xc00,0xf800} },
-{ 0,7,1,9, {0,0xc000,0xc000,0xc000,0xf800,0xcc00,0xcc00,0xcc00,0xcc00,0xcc00} },
-{ 0,3,1,9, {0,0xc000,0xc000,0,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000} },
-{ 0,4,1,11, {0,0x6000,0x6000,0,0x6000,0x6000,0x6000,0x6000,0x6000,0x6000,0x6000,0xc000} },
-{ 0,7,1,9, {0,0xc000,0xc000,0xc000,0xcc00,0xd800,0xf000,0xf000,0xd800,0xcc00} },
-{ 0,3,1,9, {0,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000} },
-{ 0,9,4,9, {0,0,0,0,0xfe00,0xdb00,0xdb00,0xdb00,0xdb00,0xdb00} },
-{ 0,7,4,9, {0,0,0,0,0xf800,0xcc00,0xcc00,0xcc00,0xcc00,0xcc00} },
-{ 0,7,4,9, {0,0,0,0,0x7800,0xcc00,0xcc00,0xcc00,0xcc00,0x7800} },
-//0x50
-{ 0,7,4,11, {0,0,0,0,0xf800,0xcc00,0xcc00,0xcc00,0xcc00,0xf800,0xc000,0xc000} },
-{ 0,7,4,11, {0,0,0,0,0x7c00,0xcc00,0xcc00,0xcc00,0xcc00,0x7c00,0xc00,0xc00} },
-{ 0,6,4,9, {0,0,0,0,0xd800,0xf800,0xe000,0xc000,0xc000,0xc000} },
-{ 0,6,4,9, {0,0,0,0,0x7800,0xc000,0xf000,0x7800,0x1800,0xf000} },
-{ 0,6,2,9, {0,0,0x6000,0x6000,0xf800,0x6000,0x6000,0x6000,0x6000,0x3800} },
-{ 0,7,4,9, {0,0,0,0,0xcc00,0xcc00,0xcc00,0xcc00,0xdc00,0x6c00} },
-{ 0,7,4,9, {0,0,0,0,0xcc00,0xcc00,0xcc00,0xcc00,0x7800,0x3000} },
-{ 0,9,4,9, {0,0,0,0,0xdb00,0xdb00,0xdb00,0xdb00,0x7e00,0x2400} },
-{ 0,7,4,9, {0,0,0,0,0xcc00,0x7800,0x3000,0x3000,0x7800,0xcc00} },
-{ 0,7,4,11, {0,0,0,0,0xcc00,0xcc00,0xcc00,0xcc00,0xcc00,0x7c00,0xc00,0xf800} },
-{ 0,6,4,9, {0,0,0,0,0xf800,0x1800,0x3000,0x6000,0xc000,0xf800} },
-{ 0,5,1,9, {0,0x3000,0x6000,0x6000,0x6000,0xc000,0x6000,0x6000,0x6000,0x3000} },
-{ 0,3,0,10, {0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000,0xc000} },
-{ 0,5,1,9, {0,0xc000,0x6000,0x6000,0x6000,0x3000,0x6000,0x6000,0x6000,0xc000} },
-{ 0,7,4,6, {0,0,0,0,0x6400,0xfc00,0x9800} },
-{ 0,8,13,0, {0} },
+  {  0, 4,  0, 0, 0, 0,  0 },  /* 0x20 ' ' */
+  {  0, 3,  1,10, 2, 0,  0 },  /* 0x21 '!' */
+  {  0, 6,  0, 3, 5, 0,  4 },  /* 0x22 '"' */
+  {  0, 8,  3, 6, 7, 0,  9 },  /* 0x23 '#' */
+  {  0, 6,  2, 9, 5, 0, 16 },  /* 0x24 '$' */
+  {  0, 6,  3, 6, 5, 0, 26 },  /* 0x25 '%' */
+  {  0, 8,  2, 8, 7, 0, 31 },  /* 0x26 '&' */
+  {  0, 3,  0, 3, 2, 0, 38 },  /* 0x27 '\'' */
+  {  0, 5,  2, 8, 4, 0, 40 },  /* 0x28 '(' */
+  {  0, 5,  2, 8, 4, 0, 44 },  /* 0x29 ')' */
+  {  0, 8,  4, 5, 7, 0, 48 },  /* 0x2a '*' */
+  {  0, 7,  3, 6, 6, 0, 55 },  /* 0x2b '+' */
+  {  0, 3,  9, 3, 2, 0, 61 },  /* 0x2c ',' */
+  {  0, 6,  5, 2, 5, 0, 63 },  /* 0x2d '-' */
+  {  0, 3,  9, 2, 2, 0, 68 },  /* 0x2e '.' */
+  {  0, 6,  2, 8, 5, 0, 70 },  /* 0x2f '/' */
+  {  0, 7,  3, 7, 6, 0, 75 },  /* 0x30 '0' */
+  {  0, 5,  2, 8, 4, 0, 81 },  /* 0x31 '1' */
+  {  0, 7,  2, 8, 6, 0, 85 },  /* 0x32 '2' */
+  {  0, 7,  2, 8, 6, 0, 91 },  /* 0x33 '3' */
+  {  0, 7,  2, 8, 6, 0, 97 },  /* 0x34 '4' */
+  {  0, 7,  2, 8, 6, 0,103 },  /* 0x35 '5' */
+  {  0, 7,  2, 8, 6, 0,109 },  /* 0x36 '6' */
+  {  0, 7,  2, 8, 6, 0,115 },  /* 0x37 '7' */
+  {  0, 7,  2, 8, 6, 0,121 },  /* 0x38 '8' */
+  {  0, 7,  2, 8, 6, 0,127 },  /* 0x39 '9' */
+  {  0, 3,  3, 6, 2, 0,133 },  /* 0x3a ':' */
+  {  0, 3,  3, 7, 2, 0,135 },  /* 0x3b ';' */
+  {  0, 6,  2, 8, 5, 0,137 },  /* 0x3c '<' */
+  {  0, 6,  3, 5, 5, 0,142 },  /* 0x3d '=' */
+  {  0, 6,  2, 8, 5, 0,147 },  /* 0x3e '>' */
+  {  0, 7,  1,10, 6, 0,152 },  /* 0x3f '?' */
+  {  0, 8,  3, 7, 7, 0,164 },  /* 0x40 '@' */
+  {  0, 8,  1, 9, 7, 0,171 },  /* 0x41 'A' */
+  {  0, 8,  1, 9, 7, 0,185 },  /* 0x42 'B' */
+  {  0, 8,  1, 9, 7, 0,199 },  /* 0x43 'C' */
+  {  0, 8,  1, 9, 7, 0,213 },  /* 0x44 'D' */
+  {  0, 7,  1, 9, 6, 0,227 },  /* 0x45 'E' */
+  {  0, 7,  1, 9, 6, 0,239 },  /* 0x46 'F' */
+  {  0, 8,  1, 9, 7, 0,251 },  /* 0x47 'G' */
+  {  0, 8,  1, 9, 7, 1,  9 },  /* 0x48 'H' */
+  {  0, 3,  1, 9, 2, 1, 23 },  /* 0x49 'I' */
+  {  0, 7,  1, 9, 6, 1, 27 },  /* 0x4a 'J' */
+  {  0, 8,  1, 9, 7, 1, 39 },  /* 0x4b 'K' */
+  {  0, 7,  1, 9, 6, 1, 53 },  /* 0x4c 'L' */
+  {  0, 9,  1, 9, 8, 1, 65 },  /* 0x4d 'M' */
+  {  0, 8,  1, 9, 7, 1, 81 },  /* 0x4e 'N' */
+  {  0, 9,  1, 9, 8, 1, 95 },  /* 0x4f 'O' */
+  {  0, 8,  1, 9, 7, 1,111 },  /* 0x50 'P' */
+  {  0, 9,  1, 9, 8, 1,125 },  /* 0x51 'Q' */
+  {  0, 8,  1, 9, 7, 1,141 },  /* 0x52 'R' */
+  {  0, 7,  1, 9, 6, 1,155 },  /* 0x53 'S' */
+  {  0, 7,  1, 9, 6, 1,167 },  /* 0x54 'T' */
+  {  0, 8,  1, 9, 7, 1,179 },  /* 0x55 'U' */
+  {  0, 8,  1, 9, 7, 1,193 },  /* 0x56 'V' */
+  {  0, 9,  1, 9, 8, 1,207 },  /* 0x57 'W' */
+  {  0, 8,  1, 9, 7, 1,223 },  /* 0x58 'X' */
+  {  0, 9,  1, 9, 8, 1,237 },  /* 0x59 'Y' */
+  {  0, 7,  1, 9, 6, 1,253 },  /* 0x5a 'Z' */
+  {  0, 5,  2, 8, 4, 2,  9 },  /* 0x5b '[' */
+  {  0, 6,  2, 8, 5, 2, 13 },  /* 0x5c '\\' */
+  {  0, 5,  2, 8, 4, 2, 18 },  /* 0x5d ']' */
+  {  0, 6,  0, 3, 5, 2, 22 },  /* 0x5e '^' */
+  {  0, 6, 11, 2, 5, 2, 27 },  /* 0x5f '_' */
+  {  0, 3,  0, 3, 2, 2, 32 },  /* 0x60 '`' */
+  {  0, 7,  4, 6, 6, 2, 34 },  /* 0x61 'a' */
+  {  0, 7,  1, 9, 6, 2, 40 },  /* 0x62 'b' */
+  {  0, 7,  4, 6, 6, 2, 52 },  /* 0x63 'c' */
+  {  0, 7,  1, 9, 6, 2, 58 },  /* 0x64 'd' */
+  {  0, 7,  4, 6, 6, 2, 70 },  /* 0x65 'e' */
+  {  0, 6,  1, 9, 5, 2, 76 },  /* 0x66 'f' */
+  {  0, 7,  4, 8, 6, 2, 86 },  /* 0x67 'g' */
+  {  0, 7,  1, 9, 6, 2, 92 },  /* 0x68 'h' */
+  {  0, 3,  1, 9, 2, 2,104 },  /* 0x69 'i' */
+  {  0, 4,  1,11, 3, 2,108 },  /* 0x6a 'j' */
+  {  0, 7,  1, 9, 6, 2,114 },  /* 0x6b 'k' */
+  {  0, 3,  1, 9, 2, 2,126 },  /* 0x6c 'l' */
+  {  0, 9,  4, 6, 8, 2,130 },  /* 0x6d 'm' */
+  {  0, 7,  4, 6, 6, 2,138 },  /* 0x6e 'n' */
+  {  0, 7,  4, 6, 6, 2,144 },  /* 0x6f 'o' */
+  {  0, 7,  4, 8, 6, 2,150 },  /* 0x70 'p' */
+  {  0, 7,  4, 8, 6, 2,156 },  /* 0x71 'q' */
+  {  0, 6,  4, 6, 5, 2,162 },  /* 0x72 'r' */
+  {  0, 6,  4, 6, 5, 2,167 },  /* 0x73 's' */
+  {  0, 6,  2, 8, 5, 2,172 },  /* 0x74 't' */
+  {  0, 7,  4, 6, 6, 2,177 },  /* 0x75 'u' */
+  {  0, 7,  4, 6, 6, 2,183 },  /* 0x76 'v' */
+  {  0, 9,  4, 6, 8, 2,189 },  /* 0x77 'w' */
+  {  0, 7,  4, 6, 6, 2,197 },  /* 0x78 'x' */
+  {  0, 7,  4, 8, 6, 2,203 },  /* 0x79 'y' */
+  {  0, 6,  4, 6, 5, 2,209 },  /* 0x7a 'z' */
+  {  0, 5,  1, 9, 4, 2,214 },  /* 0x7b '{' */
+  {  0, 3,  0,11, 2, 2,222 },  /* 0x7c '|' */
+  {  0, 5,  1, 9, 4, 2,226 },  /* 0x7d '}' */
+  {  0, 7,  4, 3, 6, 2,234 },  /* 0x7e '~' */
+  {  0, 8,  0, 0, 0, 2,240 },  /* 0x7f */
 
 /* ncode font: 0xa1 - 0xe5 */
 /* cho-sung */
-{ 0,8,13,0, {0} },  /* f1 fill code */
-{ 0,8,1,5, {0,0x7e00,0x600,0x600,0x600,0x600} },
-{ 0,10,1,5, {0,0x7f80,0x1980,0x1980,0x1980,0x1980} },
-{ 0,8,1,5, {0,0x6000,0x6000,0x6000,0x6000,0x7e00} },
-{ 0,8,1,5, {0,0x7e00,0x6000,0x6000,0x6000,0x7e00} },
-{ 0,10,1,5, {0,0x7f80,0x6600,0x6600,0x6600,0x7f80} },
-{ 0,8,1,5, {0,0x7e00,0x600,0x7e00,0x6000,0x7e00} },
-{ 0,8,1,5, {0,0x7e00,0x6600,0x6600,0x6600,0x7e00} },
-{ 0,8,1,5, {0,0x6600,0x6600,0x7e00,0x6600,0x7e00} },
-{ 0,12,1,5, {0,0x6660,0x6660,0x7fe0,0x6660,0x7fe0} },
-{ 0,8,1,5, {0,0x400,0xc00,0x1800,0x3c00,0x6600} },
-{ 0,12,1,5, {0,0x440,0xcc0,0x1980,0x3fc0,0x6660} },
-{ 0,8,1,5, {0,0x3c00,0x6600,0x6600,0x6600,0x3c00} },
-{ 0,8,1,5, {0,0x7e00,0xc00,0x1800,0x3c00,0x6600} },
-{ 0,12,1,5, {0,0x7fe0,0xcc0,0x1980,0x3fc0,0x6660} },
-{ 0,8,0,5, {0x1800,0x7e00,0xc00,0x1800,0x3c00,0x6600} },
-{ 0,8,1,5, {0,0x7e00,0x600,0x7e00,0x600,0x600} },
-{ 0,8,1,5, {0,0x7e00,0x6000,0x7e00,0x6000,0x7e00} },
-{ 0,9,1,5, {0,0x7f00,0x3600,0x3600,0x3600,0x7f00} },
-{ 0,8,0,5, {0x1800,0x7e00,0x3c00,0x6600,0x6600,0x3c00} },
+  {  0, 8,  0, 0, 0, 2,240 },  /* 0xa1 */
+  {  1, 8,  1, 5, 6, 2,240 },  /* 0xa2 */
+  {  1,10,  1, 5, 8, 2,246 },  /* 0xa3 */
+  {  1, 8,  1, 5, 6, 2,254 },  /* 0xa4 */
+  {  1, 8,  1, 5, 6, 3,  4 },  /* 0xa5 */
+  {  1,10,  1, 5, 8, 3, 10 },  /* 0xa6 */
+  {  1, 8,  1, 5, 6, 3, 18 },  /* 0xa7 */
+  {  1, 8,  1, 5, 6, 3, 24 },  /* 0xa8 */
+  {  1, 8,  1, 5, 6, 3, 30 },  /* 0xa9 */
+  {  1,12,  1, 5,10, 3, 36 },  /* 0xaa */
+  {  1, 8,  1, 5, 6, 3, 46 },  /* 0xab */
+  {  1,12,  1, 5,10, 3, 52 },  /* 0xac */
+  {  1, 8,  1, 5, 6, 3, 62 },  /* 0xad */
+  {  1, 8,  1, 5, 6, 3, 68 },  /* 0xae */
+  {  1,12,  1, 5,10, 3, 74 },  /* 0xaf */
+  {  1, 8,  0, 6, 6, 3, 84 },  /* 0xb0 */
+  {  1, 8,  1, 5, 6, 3, 90 },  /* 0xb1 */
+  {  1, 8,  1, 5, 6, 3, 96 },  /* 0xb2 */
+  {  1, 9,  1, 5, 7, 3,102 },  /* 0xb3 */
+  {  1, 8,  0, 6, 6, 3,109 },  /* 0xb4 */
 /* jung-sung */
-{ 0,0,13,0, {0} },  /* f2 fill code */
-{ 3,7,0,8, {0x1800,0x1800,0x1800,0x1e00,0x1800,0x1800,0x1800,0x1800,0x1800} },
-{ 2,8,0,8, {0x600,0x3600,0x3600,0x3e00,0x3600,0x3600,0x3600,0x600,0x600} },
-{ 3,7,0,8, {0x1800,0x1800,0x1e00,0x1800,0x1e00,0x1800,0x1800,0x1800,0x1800} },
-{ 2,8,0,8, {0x600,0x3600,0x3e00,0x3600,0x3e00,0x3600,0x3600,0x600,0x600} },
-{ 5,8,0,8, {0x600,0x600,0x600,0x1e00,0x600,0x600,0x600,0x600,0x600} },
-{ 3,9,0,8, {0x300,0x1b00,0x1b00,0x7b00,0x1b00,0x1b00,0x1b00,0x300,0x300} },
-{ 5,8,0,8, {0x600,0x600,0x1e00,0x600,0x1e00,0x600,0x600,0x600,0x600} },
-{ 3,9,0,8, {0x300,0x1b00,0x7b00,0x1b00,0x7b00,0x1b00,0x1b00,0x300,0x300} },
-{ 8,8,5,7, {0,0,0,0,0,0x1800,0x1800,0x7e00} },
-{ 8,12,0,8, {0xc0,0xc0,0xc0,0xf0,0xc0,0x18c0,0x18c0,0x7ec0,0xc0} },
-{ 8,14,0,8, {0x18,0xd8,0xd8,0xf8,0xd8,0x18d8,0x18d8,0x7e18,0x18} },
-{ 8,11,0,8, {0xc0,0xc0,0xc0,0xc0,0xc0,0x18c0,0x18c0,0x7ec0,0xc0} },
-{ 8,9,5,7, {0,0,0,0,0,0x3600,0x3600,0x7f00} },
-{ 8,8,7,9, {0,0,0,0,0,0,0,0x7e00,0x1800,0x1800} },
-{ 8,11,0,9, {0xc0,0xc0,0xc0,0x3c0,0xc0,0xc0,0xc0,0x7ec0,0x18c0,0x1800} },
-{ 8,14,0,9, {0x18,0xd8,0xd8,0x3d8,0xd8,0xd8,0xd8,0x7e18,0x1818,0x1800} },
-{ 8,11,0,9, {0xc0,0xc0,0xc0,0xc0,0xc0,0xc0,0xc0,0x7ec0,0x18c0,0x1800} },
-{ 8,9,7,9, {0,0,0,0,0,0,0,0x7f00,0x3600,0x3600} },
-{ 8,8,7,7, {0,0,0,0,0,0,0,0x7e00} },
-{ 8,11,0,8, {0xc0,0xc0,0xc0,0xc0,0xc0,0xc0,0xc0,0x7ec0,0xc0} },
-{ 5,8,0,8, {0x600,0x600,0x600,0x600,0x600,0x600,0x600,0x600,0x600} },
+  {  0, 0,  0, 0, 0, 3,115 },  /* 0xb5 */
+  {  0, 4,  0, 9, 4, 3,115 },  /* 0xb6 */
+  {  0, 6,  0, 9, 5, 3,123 },  /* 0xb7 */
+  {  0, 4,  0, 9, 4, 3,133 },  /* 0xb8 */
+  {  0, 6,  0, 9, 5, 3,141 },  /* 0xb9 */
+  { -2, 3,  0, 9, 4, 3,151 },  /* 0xba */
+  { -2, 6,  0, 9, 7, 3,159 },  /* 0xbb */
+  { -2, 3,  0, 9, 4, 3,173 },  /* 0xbc */
+  { -2, 6,  0, 9, 7, 3,181 },  /* 0xbd */
+  { -7, 0,  5, 3, 6, 3,195 },  /* 0xbe */
+  { -7, 4,  0, 9,11, 3,201 },  /* 0xbf */
+  { -7, 6,  0, 9,12, 3,223 },  /* 0xc0 */
+  { -7, 3,  0, 9, 9, 3,247 },  /* 0xc1 */
+  { -7, 1,  5, 3, 7, 4,  9 },  /* 0xc2 */
+  { -7, 0,  7, 3, 6, 4, 16 },  /* 0xc3 */
+  { -7, 3,  0,10, 9, 4, 22 },  /* 0xc4 */
+  { -7, 6,  0,10,12, 4, 40 },  /* 0xc5 */
+  { -7, 3,  0,10, 9, 4, 64 },  /* 0xc6 */
+  { -7, 1,  7, 3, 7, 4, 82 },  /* 0xc7 */
+  { -7, 0,  7, 1, 6, 4, 89 },  /* 0xc8 */
+  { -7, 3,  0, 9, 9, 4, 95 },  /* 0xc9 */
+  {  0, 3,  0, 9, 2, 4,113 },  /* 0xca */
 /* jong-sung */
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x7e00,0x600,0x600,0x600} },
-{ 9,9,9,12, {0,0,0,0,0,0,0,0,0,0x7f80,0x1980,0x1980,0x1980} },
-{ 9,9,9,12, {0,0,0,0,0,0,0,0,0,0x7980,0x1b00,0x1f00,0x1d80} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x6000,0x6000,0x6000,0x7e00} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x6000,0x6f80,0x6300,0x7f00,0xd80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x6300,0x6f80,0x6700,0x7d80,0x700} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x7e00,0x6000,0x6000,0x7e00} },
-{ 8,8,9,13, {0,0,0,0,0,0,0,0,0,0x7e00,0x600,0x7e00,0x6000,0x7e00} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7800,0x1f80,0x7980,0x6180,0x7d80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7800,0x1f80,0x7d80,0x6d80,0x7f80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7800,0x1d80,0x7f80,0x6d80,0x7f80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7800,0x1980,0x7b00,0x6700,0x7d80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7f80,0x1e00,0x7f80,0x6600,0x7f80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7800,0x1f80,0x7b00,0x6300,0x7f80} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x7b00,0x1f80,0x7700,0x6d80,0x7f00} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x7e00,0x6600,0x6600,0x7e00} },
-{ 8,8,9,13, {0,0,0,0,0,0,0,0,0,0x6600,0x6600,0x7e00,0x6600,0x7e00} },
-{ 9,9,9,13, {0,0,0,0,0,0,0,0,0,0x6c80,0x6d80,0x7f00,0x6f80,0x7d80} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0xc00,0x1800,0x3c00,0x6600} },
-{ 9,9,9,12, {0,0,0,0,0,0,0,0,0,0xd80,0x1b00,0x3f00,0x6d80} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x3c00,0x6600,0x6600,0x3c00} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x7e00,0x1800,0x3c00,0x6600} },
-{ 8,8,9,13, {0,0,0,0,0,0,0,0,0,0x1800,0x7e00,0x1800,0x3c00,0x6600} },
-{ 8,8,9,13, {0,0,0,0,0,0,0,0,0,0x7e00,0x600,0x7e00,0x600,0x600} },
-{ 8,8,9,13, {0,0,0,0,0,0,0,0,0,0x7e00,0x6000,0x7e00,0x6000,0x7e00} },
-{ 8,8,9,12, {0,0,0,0,0,0,0,0,0,0x7f00,0x3600,0x3600,0x7f00} },
-{ 8,8,9,13, {0,0,0,0,0,0,0,0,0,0x1800,0x7e00,0x3c00,0x6600,0x3c00} },
+  { -7, 0,  9, 4, 6, 4,117 },  /* 0xcb */
+  { -8, 0,  9, 4, 8, 4,123 },  /* 0xcc */
+  { -8, 0,  9, 4, 8, 4,131 },  /* 0xcd */
+  { -7, 0,  9, 4, 6, 4,139 },  /* 0xce */
+  { -8, 0,  9, 5, 8, 4,145 },  /* 0xcf */
+  { -8, 0,  9, 5, 8, 4,153 },  /* 0xd0 */
+  { -7, 0,  9, 4, 6, 4,161 },  /* 0xd1 */
+  { -7, 0,  9, 5, 6, 4,167 },  /* 0xd2 */
+  { -8, 0,  9, 5, 8, 4,173 },  /* 0xd3 */
+  { -8, 0,  9, 5, 8, 4,181 },  /* 0xd4 */
+  { -8, 0,  9, 5, 8, 4,189 },  /* 0xd5 */
+  { -8, 0,  9, 5, 8, 4,197 },  /* 0xd6 */
+  { -8, 0,  9, 5, 8, 4,205 },  /* 0xd7 */
+  { -8, 0,  9, 5, 8, 4,213 },  /* 0xd8 */
+  { -8, 0,  9, 5, 8, 4,221 },  /* 0xd9 */
+  { -7, 0,  9, 4, 6, 4,229 },  /* 0xda */
+  { -7, 0,  9, 5, 6, 4,235 },  /* 0xdb */
+  { -8, 0,  9, 5, 8, 4,241 },  /* 0xdc */
+  { -7, 0,  9, 4, 6, 4,249 },  /* 0xdd */
+  { -8, 0,  9, 4, 8, 4,255 },  /* 0xde */
+  { -7, 0,  9, 4, 6, 5,  7 },  /* 0xdf */
+  { -7, 0,  9, 4, 6, 5, 13 },  /* 0xe0 */
+  { -7, 0,  9, 5, 6, 5, 19 },  /* 0xe1 */
+  { -7, 0,  9, 5, 6, 5, 25 },  /* 0xe2 */
+  { -7, 0,  9, 5, 6, 5, 31 },  /* 0xe3 */
+  { -7, 0,  9, 4, 7, 5, 37 },  /* 0xe4 */
+  { -7, 0,  9, 5, 6, 5, 44 },  /* 0xe5 */
+};
+
+const uint8_t font_columns[] PROGMEM = {
+  0x7f,0x03,0x7f,0x03,  /* 0x21 '!' */
+  0x07,0x03,0x00,0x07,0x03,  /* 0x22 '"' */
+  0x12,0x3f,0x3f,0x12,0x3f,0x3f,0x12,  /* 0x23 '#' */
+  0x4c,0x00,0x92,0x00,0xff,0x01,0x92,0x00,0x64,0x00,  /* 0x24 '$' */
+  0x33,0x1b,0x0c,0x36,0x33,  /* 0x25 '%' */
+  0x66,0xff,0x99,0xdf,0x76,0x70,0xd0,  /* 0x26 '&' */
+  0x07,0x03,  /* 0x27 '\'' */
+  0x3c,0x7e,0xc3,0x81,  /* 0x28 '(' */
+  0x81,0xc3,0x7e,0x3c,  /* 0x29 ')' */
+  0x04,0x15,0x1f,0x0e,0x1f,0x15,0x04,  /* 0x2a '*' */
+  0x0c,0x0c,0x3f,0x3f,0x0c,0x0c,  /* 0x2b '+' */
+  0x07,0x03,  /* 0x2c ',' */
+  0x03,0x03,0x03,0x03,0x03,  /* 0x2d '-' */
+  0x03,0x03,  /* 0x2e '.' */
+  0xc0,0xf0,0x3c,0x0f,0x03,  /* 0x2f '/' */
+  0x3e,0x7f,0x41,0x41,0x7f,0x3e,  /* 0x30 '0' */
+  0x82,0xff,0xff,0x80,  /* 0x31 '1' */
+  0x86,0xc7,0xe1,0xb1,0x9f,0xce,  /* 0x32 '2' */
+  0x66,0xe7,0x81,0x89,0xff,0x76,  /* 0x33 '3' */
+  0x30,0x38,0xac,0xfe,0xff,0xa0,  /* 0x34 '4' */
+  0x4f,0xcf,0x89,0x89,0xf9,0x71,  /* 0x35 '5' */
+  0x7c,0xfe,0x8b,0x89,0xf9,0x70,  /* 0x36 '6' */
+  0x03,0x03,0xe1,0xf9,0x1f,0x07,  /* 0x37 '7' */
+  0x76,0xff,0x89,0x89,0xff,0x76,  /* 0x38 '8' */
+  0x0e,0x9f,0x91,0xd1,0x7f,0x3e,  /* 0x39 '9' */
+  0x33,0x33,  /* 0x3a ':' */
+  0x73,0x33,  /* 0x3b ';' */
+  0x18,0x3c,0x66,0xc3,0x81,  /* 0x3c '<' */
+  0x1b,0x1b,0x1b,0x1b,0x1b,  /* 0x3d '=' */
+  0x81,0xc3,0x66,0x3c,0x18,  /* 0x3e '>' */
+  0x06,0x00,0x07,0x00,0x61,0x03,0x71,0x03,0x1f,0x00,0x0e,0x00,  /* 0x3f '?' */
+  0x1c,0x22,0x59,0x55,0x5d,0x32,0x1c,  /* 0x40 '@' */
+  0xf8,0x01,0xfc,0x01,0x26,0x00,0x23,0x00,0x26,0x00,0xfc,0x01,0xf8,0x01,  /* 0x41 'A' */
+  0xff,0x01,0xff,0x01,0x11,0x01,0x11,0x01,0x11,0x01,0xff,0x01,0xee,0x00,  /* 0x42 'B' */
+  0x7c,0x00,0xfe,0x00,0x83,0x01,0x01,0x01,0x01,0x01,0x83,0x01,0xc6,0x00,  /* 0x43 'C' */
+  0xff,0x01,0xff,0x01,0x01,0x01,0x01,0x01,0x83,0x01,0xfe,0x00,0x7c,0x00,  /* 0x44 'D' */
+  0xff,0x01,0xff,0x01,0x11,0x01,0x11,0x01,0x11,0x01,0x01,0x01,  /* 0x45 'E' */
+  0xff,0x01,0xff,0x01,0x11,0x00,0x11,0x00,0x11,0x00,0x01,0x00,  /* 0x46 'F' */
+  0x7c,0x00,0xfe,0x00,0x83,0x01,0x01,0x01,0x21,0x01,0xe3,0x01,0xe6,0x01,  /* 0x47 'G' */
+  0xff,0x01,0xff,0x01,0x10,0x00,0x10,0x00,0x10,0x00,0xff,0x01,0xff,0x01,  /* 0x48 'H' */
+  0xff,0x01,0xff,0x01,  /* 0x49 'I' */
+  0xc0,0x00,0xc0,0x01,0x00,0x01,0x00,0x01,0xff,0x01,0xff,0x00,  /* 0x4a 'J' */
+  0xff,0x01,0xff,0x01,0x38,0x00,0x6c,0x00,0xc6,0x00,0x83,0x01,0x01,0x01,  /* 0x4b 'K' */
+  0xff,0x01,0xff,0x01,0x00,0x01,0x00,0x01,0x00,0x01,0x00,0x01,  /* 0x4c 'L' */
+  0xff,0x01,0xff,0x01,0x06,0x00,0x1c,0x00,0x1c,0x00,0x06,0x00,0xff,0x01,0xff,0x01,  /* 0x4d 'M' */
+  0xff,0x01,0xff,0x01,0x0c,0x00,0x18,0x00,0x30,0x00,0xff,0x01,0xff,0x01,  /* 0x4e 'N' */
+  0x7c,0x00,0xfe,0x00,0x83,0x01,0x01,0x01,0x01,0x01,0x83,0x01,0xfe,0x00,0x7c,0x00,  /* 0x4f 'O' */
+  0xff,0x01,0xff,0x01,0x11,0x00,0x11,0x00,0x11,0x00,0x1f,0x00,0x0e,0x00,  /* 0x50 'P' */
+  0x7c,0x00,0xfe,0x00,0x83,0x01,0x41,0x01,0x41,0x01,0xc3,0x01,0xfe,0x01,0x7c,0x01,  /* 0x51 'Q' */
+  0xff,0x01,0xff,0x01,0x31,0x00,0x71,0x00,0xd1,0x00,0x9f,0x01,0x0e,0x01,  /* 0x52 'R' */
+  0xce,0x00,0x9f,0x01,0x19,0x01,0x31,0x01,0xf3,0x01,0xe6,0x00,  /* 0x53 'S' */
+  0x01,0x00,0x01,0x00,0xff,0x01,0xff,0x01,0x01,0x00,0x01,0x00,  /* 0x54 'T' */
+  0xff,0x00,0xff,0x01,0x00,0x01,0x00,0x01,0x00,0x01,0xff,0x01,0xff,0x00,  /* 0x55 'U' */
+  0x1f,0x00,0x7f,0x00,0xe0,0x00,0x80,0x01,0xe0,0x00,0x7f,0x00,0x1f,0x00,  /* 0x56 'V' */
+  0xff,0x01,0xff,0x01,0xc0,0x00,0x70,0x00,0x70,0x00,0xc0,0x00,0xff,0x01,0xff,0x01,  /* 0x57 'W' */
+  0x83,0x01,0xc7,0x01,0x6c,0x00,0x38,0x00,0x6c,0x00,0xc7,0x01,0x83,0x01,  /* 0x58 'X' */
+  0x03,0x00,0x07,0x00,0x0c,0x00,0xf8,0x01,0xf8,0x01,0x0c,0x00,0x07,0x00,0x03,0x00,  /* 0x59 'Y' */
+  0xc1,0x01,0xe1,0x01,0x31,0x01,0x19,0x01,0x0f,0x01,0x07,0x01,  /* 0x5a 'Z' */
+  0xff,0xff,0x81,0x81,  /* 0x5b '[' */
+  0x03,0x0f,0x3c,0xf0,0xc0,  /* 0x5c '\\' */
+  0x81,0x81,0xff,0xff,  /* 0x5d ']' */
+  0x04,0x06,0x03,0x06,0x04,  /* 0x5e '^' */
+  0x03,0x03,0x03,0x03,0x03,  /* 0x5f '_' */
+  0x03,0x07,  /* 0x60 '`' */
+  0x18,0x3d,0x25,0x25,0x3f,0x3e,  /* 0x61 'a' */
+  0xff,0x01,0xff,0x01,0x08,0x01,0x08,0x01,0xf8,0x01,0xf0,0x00,  /* 0x62 'b' */
+  0x1e,0x3f,0x21,0x21,0x33,0x12,  /* 0x63 'c' */
+  0xf0,0x00,0xf8,0x01,0x08,0x01,0x08,0x01,0xff,0x01,0xff,0x01,  /* 0x64 'd' */
+  0x1e,0x3f,0x25,0x25,0x37,0x16,  /* 0x65 'e' */
+  0x08,0x00,0xfe,0x01,0xff,0x01,0x09,0x00,0x09,0x00,  /* 0x66 'f' */
+  0x9e,0xbf,0xa1,0xa1,0xff,0x7f,  /* 0x67 'g' */
+  0xff,0x01,0xff,0x01,0x08,0x00,0x08,0x00,0xf8,0x01,0xf0,0x01,  /* 0x68 'h' */
+  0xfb,0x01,0xfb,0x01,  /* 0x69 'i' */
+  0x00,0x04,0xfb,0x07,0xfb,0x03,  /* 0x6a 'j' */
+  0xff,0x01,0xff,0x01,0x60,0x00,0xf0,0x00,0x98,0x01,0x08,0x01,  /* 0x6b 'k' */
+  0xff,0x01,0xff,0x01,  /* 0x6c 'l' */
+  0x3f,0x3f,0x01,0x3f,0x3f,0x01,0x3f,0x3e,  /* 0x6d 'm' */
+  0x3f,0x3f,0x01,0x01,0x3f,0x3e,  /* 0x6e 'n' */
+  0x1e,0x3f,0x21,0x21,0x3f,0x1e,  /* 0x6f 'o' */
+  0xff,0xff,0x21,0x21,0x3f,0x1e,  /* 0x70 'p' */
+  0x1e,0x3f,0x21,0x21,0xff,0xff,  /* 0x71 'q' */
+  0x3f,0x3f,0x06,0x03,0x03,  /* 0x72 'r' */
+  0x26,0x2f,0x2d,0x3d,0x19,  /* 0x73 's' */
+  0x04,0x7f,0xff,0x84,0x84,  /* 0x74 't' */
+  0x1f,0x3f,0x20,0x10,0x3f,0x3f,  /* 0x75 'u' */
+  0x0f,0x1f,0x30,0x30,0x1f,0x0f,  /* 0x76 'v' */
+  0x0f,0x1f,0x30,0x1f,0x1f,0x30,0x1f,0x0f,  /* 0x77 'w' */
+  0x21,0x33,0x1e,0x1e,0x33,0x21,  /* 0x78 'x' */
+  0x9f,0xbf,0xa0,0xa0,0xff,0x7f,  /* 0x79 'y' */
+  0x31,0x39,0x2d,0x27,0x23,  /* 0x7a 'z' */
+  0x10,0x00,0xfe,0x00,0xef,0x01,0x01,0x01,  /* 0x7b '{' */
+  0xff,0x07,0xff,0x07,  /* 0x7c '|' */
+  0x01,0x01,0xef,0x01,0xfe,0x00,0x10,0x00,  /* 0x7d '}' */
+  0x06,0x03,0x03,0x06,0x06,0x03,  /* 0x7e '~' */
+  0x01,0x01,0x01,0x01,0x1f,0x1f,  /* 0xa2 */
+  0x01,0x01,0x1f,0x1f,0x01,0x01,0x1f,0x1f,  /* 0xa3 */
+  0x1f,0x1f,0x10,0x10,0x10,0x10,  /* 0xa4 */
+  0x1f,0x1f,0x11,0x11,0x11,0x11,  /* 0xa5 */
+  0x1f,0x1f,0x11,0x11,0x1f,0x1f,0x11,0x11,  /* 0xa6 */
+  0x1d,0x1d,0x15,0x15,0x17,0x17,  /* 0xa7 */
+  0x1f,0x1f,0x11,0x11,0x1f,0x1f,  /* 0xa8 */
+  0x1f,0x1f,0x14,0x14,0x1f,0x1f,  /* 0xa9 */
+  0x1f,0x1f,0x14,0x14,0x1f,0x1f,0x14,0x14,0x1f,0x1f,  /* 0xaa */
+  0x10,0x18,0x0c,0x0e,0x1b,0x10,  /* 0xab */
+  0x10,0x18,0x0c,0x0e,0x1b,0x18,0x0c,0x0e,0x1b,0x10,  /* 0xac */
+  0x0e,0x1f,0x11,0x11,0x1f,0x0e,  /* 0xad */
+  0x11,0x19,0x0d,0x0f,0x1b,0x11,  /* 0xae */
+  0x11,0x19,0x0d,0x0f,0x1b,0x19,0x0d,0x0f,0x1b,0x11,  /* 0xaf */
+  0x22,0x32,0x1b,0x1f,0x36,0x22,  /* 0xb0 */
+  0x05,0x05,0x05,0x05,0x1f,0x1f,  /* 0xb1 */
+  0x1f,0x1f,0x15,0x15,0x15,0x15,  /* 0xb2 */
+  0x11,0x1f,0x1f,0x11,0x1f,0x1f,0x11,  /* 0xb3 */
+  0x1a,0x3e,0x27,0x27,0x3e,0x1a,  /* 0xb4 */
+  0xff,0x01,0xff,0x01,0x08,0x00,0x08,0x00,  /* 0xb6 */
+  0x7e,0x00,0x7e,0x00,0x08,0x00,0xff,0x01,0xff,0x01,  /* 0xb7 */
+  0xff,0x01,0xff,0x01,0x14,0x00,0x14,0x00,  /* 0xb8 */
+  0x7e,0x00,0x7e,0x00,0x14,0x00,0xff,0x01,0xff,0x01,  /* 0xb9 */
+  0x08,0x00,0x08,0x00,0xff,0x01,0xff,0x01,  /* 0xba */
+  0x08,0x00,0x08,0x00,0x7e,0x00,0x7e,0x00,0x00,0x00,0xff,0x01,0xff,0x01,  /* 0xbb */
+  0x14,0x00,0x14,0x00,0xff,0x01,0xff,0x01,  /* 0xbc */
+  0x14,0x00,0x14,0x00,0x7e,0x00,0x7e,0x00,0x00,0x00,0xff,0x01,0xff,0x01,  /* 0xbd */
+  0x04,0x04,0x07,0x07,0x04,0x04,  /* 0xbe */
+  0x80,0x00,0x80,0x00,0xe0,0x00,0xe0,0x00,0x80,0x00,0x80,0x00,0x00,0x00,0xff,0x01,0xff,0x01,0x08,0x00,0x08,0x00,  /* 0xbf */
+  0x80,0x00,0x80,0x00,0xe0,0x00,0xe0,0x00,0x80,0x00,0x80,0x00,0x00,0x00,0x7e,0x00,0x7e,0x00,0x08,0x00,0xff,0x01,0xff,0x01,  /* 0xc0 */
+  0x80,0x00,0x80,0x00,0xe0,0x00,0xe0,0x00,0x80,0x00,0x80,0x00,0x00,0x00,0xff,0x01,0xff,0x01,  /* 0xc1 */
+  0x04,0x07,0x07,0x04,0x07,0x07,0x04,  /* 0xc2 */
+  0x01,0x01,0x07,0x07,0x01,0x01,  /* 0xc3 */
+  0x80,0x00,0x80,0x00,0x80,0x03,0x80,0x03,0x80,0x00,0x88,0x00,0x08,0x00,0xff,0x01,0xff,0x01,  /* 0xc4 */
+  0x80,0x00,0x80,0x00,0x80,0x03,0x80,0x03,0x80,0x00,0x88,0x00,0x08,0x00,0x7e,0x00,0x7e,0x00,0x00,0x00,0xff,0x01,0xff,0x01,  /* 0xc5 */
+  0x80,0x00,0x80,0x00,0x80,0x03,0x80,0x03,0x80,0x00,0x80,0x00,0x00,0x00,0xff,0x01,0xff,0x01,  /* 0xc6 */
+  0x01,0x07,0x07,0x01,0x07,0x07,0x01,  /* 0xc7 */
+  0x01,0x01,0x01,0x01,0x01,0x01,  /* 0xc8 */
+  0x80,0x00,0x80,0x00,0x80,0x00,0x80,0x00,0x80,0x00,0x80,0x00,0x00,0x00,0xff,0x01,0xff,0x01,  /* 0xc9 */
+  0xff,0x01,0xff,0x01,  /* 0xca */
+  0x01,0x01,0x01,0x01,0x0f,0x0f,  /* 0xcb */
+  0x01,0x01,0x0f,0x0f,0x01,0x01,0x0f,0x0f,  /* 0xcc */
+  0x01,0x01,0x0f,0x0f,0x0c,0x06,0x0f,0x09,  /* 0xcd */
+  0x0f,0x0f,0x08,0x08,0x08,0x08,  /* 0xce */
+  0x0f,0x0f,0x08,0x1a,0x1a,0x0e,0x1e,0x12,  /* 0xcf */
+  0x0f,0x0f,0x08,0x0a,0x1e,0x17,0x1f,0x0a,  /* 0xd0 */
+  0x0f,0x0f,0x09,0x09,0x09,0x09,  /* 0xd1 */
+  0x1d,0x1d,0x15,0x15,0x17,0x17,  /* 0xd2 */
+  0x1d,0x1d,0x17,0x17,0x12,0x02,0x1e,0x1e,  /* 0xd3 */
+  0x1d,0x1d,0x17,0x1f,0x1e,0x12,0x1e,0x1e,  /* 0xd4 */
+  0x1d,0x1d,0x17,0x1f,0x1e,0x14,0x1e,0x1e,  /* 0xd5 */
+  0x1d,0x1d,0x17,0x17,0x18,0x0c,0x1e,0x12,  /* 0xd6 */
+  0x1d,0x1d,0x17,0x17,0x1f,0x1f,0x15,0x15,  /* 0xd7 */
+  0x1d,0x1d,0x17,0x17,0x12,0x1e,0x1e,0x12,  /* 0xd8 */
+  0x1d,0x1d,0x17,0x1b,0x1e,0x17,0x1f,0x0a,  /* 0xd9 */
+  0x0f,0x0f,0x09,0x09,0x0f,0x0f,  /* 0xda */
+  0x1f,0x1f,0x14,0x14,0x1f,0x1f,  /* 0xdb */
+  0x1f,0x1f,0x14,0x1f,0x1f,0x0c,0x1e,0x1b,  /* 0xdc */
+  0x08,0x0c,0x06,0x07,0x0d,0x08,  /* 0xdd */
+  0x08,0x0c,0x06,0x0f,0x0d,0x06,0x0f,0x09,  /* 0xde */
+  0x06,0x0f,0x09,0x09,0x0f,0x06,  /* 0xdf */
+  0x09,0x0d,0x07,0x07,0x0d,0x09,  /* 0xe0 */
+  0x12,0x1a,0x0f,0x0f,0x1a,0x12,  /* 0xe1 */
+  0x05,0x05,0x05,0x05,0x1f,0x1f,  /* 0xe2 */
+  0x1f,0x1f,0x15,0x15,0x15,0x15,  /* 0xe3 */
+  0x09,0x0f,0x0f,0x09,0x0f,0x0f,0x09,  /* 0xe4 */
+  0x0a,0x1e,0x17,0x17,0x1e,0x0a,  /* 0xe5 */
 };
 
+static const font_item *font_item_of(int c)
+{
+  return ((c >= 0x20 && c <= 0x7f)? &font_data[c - 0x20] :
+          (c >= 0xa1 && c <= 0xe5)? &font_data[(c - 0xa1) + 0x60] :
+          NULL);
+}
+
 static int font_width(int c)
 {
-  const font_item *font = 
-      ((c >= 0x20 && c <= 0x7f)? &font_data[c - 0x20] :
-       (c >= 0xa1 && c <= 0xe5)? &font_data[(c - 0xa1) + 0x60] :
-       NULL);
+  const font_item *font = font_item_of(c);
   if (font == NULL)
     return 0;
-  return pgm_read_byte_near(&font->end) - pgm_read_byte_near(&font->start);
+  return pgm_read_byte_near(&font->advance);
 }
 
 static int draw_font(OLEDDisplay *d, int ox, int oy, int c)
   /* returns next x */
 {
-  unsigned short image;
-  int top_bound, bottom_bound;
-  int x, y;
-  const font_item *font = 
-      ((c >= 0x20 && c <= 0x7f)? &font_data[c - 0x20] :
-       (c >= 0xa1 && c <= 0xe5)? &font_data[(c - 0xa1) + 0x60] :
-       NULL);
+  const font_item *font = font_item_of(c);
+  const uint8_t *p;
+  uint8_t *buf = d->buffer;
+  OLEDDISPLAY_COLOR color = d->getColor();
+  uint32_t col;
+  int height, width, nbytes;
+  int x, y, i, page, lshift, rshift;
+
   if (font == NULL)
     return ox;
+  if (buf == NULL || (height = pgm_read_byte_near(&font->height)) == 0)
+    return ox + pgm_read_byte_near(&font->advance);
+
+  width = pgm_read_byte_near(&font->width);
+  nbytes = (height + 7) / 8;
+  p = font_columns + (((int)pgm_read_byte_near(&font->offset_b1) << 8) +
+                       (int)pgm_read_byte_near(&font->offset_b0));
+
+  /* split y into start page and bit shift; rows above the screen are
+     shifted out of each column instead */
+  y = oy + pgm_read_byte_near(&font->top);
+  if (y >= DISPLAY_HEIGHT || y + height <= 0)
+    return ox + pgm_read_byte_near(&font->advance);
+  if (y < 0) { page = 0;      lshift = 0;     rshift = -y; }
+  else       { page = y >> 3; lshift = y & 7; rshift = 0;  }
+
+  x = ox + (int8_t)pgm_read_byte_near(&font->xoff);
+  for (i = 0; i < width; i++, x++) {
+    col = pgm_read_byte_near(p++);
+    if (nbytes == 2)
+      col |= (uint32_t)pgm_read_byte_near(p++) << 8;
+    if (x < 0 || x >= DISPLAY_WIDTH)
+      continue;
 
-  bottom_bound = pgm_read_byte_near(&font->bottom_bound);
-  ox -= pgm_read_byte_near(&font->start);
+    /* blit the column into (up to 3) consecutive display pages in the
+       display color, as setPixel() would */
+    col = (col >> rshift) << lshift;
+    for (y = page; col && y < DISPLAY_HEIGHT / 8; y++, col >>= 8) {
+      switch (color) {
+      case WHITE:   buf[x + y * DISPLAY_WIDTH] |= (uint8_t)col;  break;
+      case BLACK:   buf[x + y * DISPLAY_WIDTH] &= ~(uint8_t)col; break;
+      case INVERSE: buf[x + y * DISPLAY_WIDTH] ^= (uint8_t)col;  break;
+      }
+    }
+  }
 
-  for (y = pgm_read_byte_near(&font->top_bound); y <= bottom_bound; y++)
-    for (image = pgm_read_word_near(&font->image[y]), x = ox; image; image <<= 1, x++)
-      if ((image & 0x8000))
-        d->setPixel(x, y + oy);
-      
-  return ox + pgm_read_byte_near(&font->end);
+  return ox + pgm_read_byte_near(&font->advance);
 }
 
 void n3f_drawString(OLEDDisplay *d, int x, int y, const char* utf8_str)
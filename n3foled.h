@@ -3,7 +3,7 @@
  * Lee Yongjae, setup74p@gmail.com, 2017-04-28.
  */
 
-/* y is 0 at top and 13 at bottom */
+/* y is 0 at top and 13 at bottom; drawn in the color set by setColor() */
 
 
 #ifndef __N3FOLED_H__
@@ -11,8 +11,8 @@
 
 #include <OLEDDisplay.h>
 
-void n3f_drawString(OLEDDisplay *d, int x, int y, char* utf8_str);
-void n3f_drawStringMaxWidth(OLEDDisplay *d, int x, int y, int maxWidth, char* utf8_str);
+void n3f_drawString(OLEDDisplay *d, int x, int y, const char* utf8_str);
+void n3f_drawStringMaxWidth(OLEDDisplay *d, int x, int y, int maxWidth, const char* utf8_str);
 
 #endif  /* __N3FOLED_H__ */
 
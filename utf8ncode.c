@@ -66,6 +66,9 @@ versions:
 /* Unicode Hangul Jamo code: 0x1100~0x11ff */
 /* See: https://en.wikipedia.org/wiki/Hangul_Jamo_(Unicode_block) */
 
+/* Unicode Hangul Compatibility Jamo code: 0x3131~0x318e */
+/* consonants 0x3131~0x314e and vowels 0x314f~0x3163 are in use */
+
 
 int
 utf8_to_utf32(const unsigned char *utf8_str, int *utf32_ret)
@@ -104,6 +107,34 @@ utf8_to_utf32(const unsigned char *utf8_str, int *utf32_ret)
   return n;
 }
 
+int
+utf32_to_utf8(int utf32, unsigned char *utf8_buf)
+  /* returns number of utf8 chars written (1~4); utf8_buf is not terminated */
+{
+  unsigned char *p = utf8_buf;
+  int c = utf32;
+
+  if (c < 0x80) {
+    *p++ = (unsigned char)c;
+  }
+  else if (c < 0x800) {
+    *p++ = (unsigned char)(0xc0 | (c >> 6));
+    *p++ = (unsigned char)(0x80 | (c & 0x3f));
+  }
+  else if (c < 0x10000) {
+    *p++ = (unsigned char)(0xe0 | (c >> 12));
+    *p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3f));
+    *p++ = (unsigned char)(0x80 | (c & 0x3f));
+  }
+  else {
+    *p++ = (unsigned char)(0xf0 | ((c >> 18) & 0x07));
+    *p++ = (unsigned char)(0x80 | ((c >> 12) & 0x3f));
+    *p++ = (unsigned char)(0x80 | ((c >> 6) & 0x3f));
+    *p++ = (unsigned char)(0x80 | (c & 0x3f));
+  }
+  return p - utf8_buf;
+}
+
 int
 utf8_to_n3f(const unsigned char *utf8_str, unsigned char *n3f_buf, int n3f_buf_size)
   /* returns strlen of n3f_buf */
@@ -165,3 +196,234 @@ utf8_to_n3f(const unsigned char *utf8_str, unsigned char *n3f_buf, int n3f_buf_s
   return p - n3f_buf;
 }
 
+
+
+/*
+ * Hangul jamo composing
+ *
+ * cho: ChoSeong index 0~18, jung: JungSeong index 0~20,
+ * jong: JongSeong index 1~27 (0 for none); same as Johap syllable indexes
+ */
+
+/* compatibility consonants 0x3131~0x314e: { cho (-1: none), jong (0: none) } */
+static const signed char compat_consonant[30][2] = {
+  {  0, 1 }, {  1, 2 }, { -1, 3 }, {  2, 4 }, { -1, 5 }, { -1, 6 },  /* g gg gs n nj nh */
+  {  3, 7 }, {  4, 0 }, {  5, 8 }, { -1, 9 }, { -1,10 }, { -1,11 },  /* d dd r rg rm rb */
+  { -1,12 }, { -1,13 }, { -1,14 }, { -1,15 }, {  6,16 }, {  7,17 },  /* rs rt rp rh m b */
+  {  8, 0 }, { -1,18 }, {  9,19 }, { 10,20 }, { 11,21 }, { 12,22 },  /* bb bs s ss ng j */
+  { 13, 0 }, { 14,23 }, { 15,24 }, { 16,25 }, { 17,26 }, { 18,27 },  /* jj ch k t p h */
+};
+
+/* cho to compatibility consonant: 0x3100 + n */
+static const unsigned char cho_to_compat[19] = {
+  0x31, 0x32, 0x34, 0x37, 0x38, 0x39, 0x41, 0x42, 0x43, 0x45,
+  0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e,
+};
+
+/* simple jong to cho (-1 for compound jong) */
+static const signed char jong_to_cho[28] = {
+  -1,  0,  1, -1,  2, -1, -1,  3,  5, -1, -1, -1, -1, -1,
+  -1, -1,  6,  7, -1,  9, 10, 11, 12, 14, 15, 16, 17, 18,
+};
+
+/* compound jong: { first jong, second jong, compound jong } */
+static const unsigned char compound_jong[11][3] = {
+  {  1, 19,  3 }, {  4, 22,  5 }, {  4, 27,  6 }, {  8,  1,  9 },
+  {  8, 16, 10 }, {  8, 17, 11 }, {  8, 19, 12 }, {  8, 25, 13 },
+  {  8, 26, 14 }, {  8, 27, 15 }, { 17, 19, 18 },
+};
+
+/* compound jung: { first jung, second jung, compound jung } */
+static const unsigned char compound_jung[7][3] = {
+  {  8,  0,  9 }, {  8,  1, 10 }, {  8, 20, 11 }, { 13,  4, 14 },
+  { 13,  5, 15 }, { 13, 20, 16 }, { 18, 20, 19 },
+};
+
+static int
+compose_jong(int first, int second)
+  /* returns compound jong of first + second, or 0 */
+{
+  int i;
+  for (i = 0; i < 11; i++)
+    if (compound_jong[i][0] == first && compound_jong[i][1] == second)
+      return compound_jong[i][2];
+  return 0;
+}
+
+static int
+compose_jung(int first, int second)
+  /* returns compound jung of first + second, or -1 */
+{
+  int i;
+  for (i = 0; i < 7; i++)
+    if (compound_jung[i][0] == first && compound_jung[i][1] == second)
+      return compound_jung[i][2];
+  return -1;
+}
+
+/* pending syllable being composed */
+struct hangul_compose {
+  int cho, jung, jong;  /* -1, -1, 0 for none */
+  int keyed;            /* composed from compatibility jamo (typed keys) */
+  unsigned char *p;     /* output pointer */
+  unsigned char *p_limit;
+};
+
+static int
+compose_put(struct hangul_compose *h, int uc)
+  /* returns 0 on buffer overflow */
+{
+  unsigned char b[4];
+  int n = utf32_to_utf8(uc, b);
+  if (h->p + n > h->p_limit)
+    return 0;
+  memcpy(h->p, b, n);
+  h->p += n;
+  return 1;
+}
+
+static int
+compose_flush(struct hangul_compose *h)
+  /* writes out pending syllable or standalone jamo; returns 0 on overflow */
+{
+  int r = 1;
+  if (h->cho >= 0 && h->jung >= 0)
+    r = compose_put(h, 44032 + (h->cho * 21 + h->jung) * 28 + h->jong);
+  else if (h->cho >= 0)
+    r = compose_put(h, (h->keyed)? 0x3100 + cho_to_compat[h->cho] : 0x1100 + h->cho);
+  else if (h->jung >= 0)
+    r = compose_put(h, (h->keyed)? 0x314f + h->jung : 0x1161 + h->jung);
+  h->cho = -1;
+  h->jung = -1;
+  h->jong = 0;
+  h->keyed = 0;
+  return r;
+}
+
+int
+utf8_compose_hangul(const unsigned char *utf8_str, unsigned char *out_buf, int out_buf_size)
+  /* returns strlen of out_buf */
+{
+  /* NOTE: output of a pending syllable is never longer than its input,
+     so out_buf may be utf8_str itself */
+  const unsigned char *s;
+  struct hangul_compose h;
+  int uc, n, c, j;
+
+  h.cho = -1; h.jung = -1; h.jong = 0; h.keyed = 0;
+  h.p = out_buf;
+  h.p_limit = out_buf + out_buf_size - 1;
+
+  for (s = utf8_str; *s && (n = utf8_to_utf32(s, &uc)) > 0; s += n) {
+    if (uc >= 0x1100 && uc <= 0x1112) {
+      /* conjoining ChoSeong: always starts a syllable */
+      if (!compose_flush(&h)) break;
+      h.cho = uc - 0x1100;
+    }
+    else if (uc >= 0x1161 && uc <= 0x1175) {
+      /* conjoining JungSeong */
+      if (h.cho >= 0 && h.jung < 0) {
+        h.jung = uc - 0x1161;
+      } else {
+        if (!compose_flush(&h)) break;
+        h.jung = uc - 0x1161;
+      }
+    }
+    else if (uc >= 0x11a8 && uc <= 0x11c2) {
+      /* conjoining JongSeong: only on a syllable without one */
+      if (h.cho >= 0 && h.jung >= 0 && h.jong == 0) {
+        h.jong = uc - 0x11a8 + 1;
+      } else {
+        if (!compose_flush(&h) || !compose_put(&h, uc)) break;
+      }
+    }
+    else if (uc >= 0x3131 && uc <= 0x314e) {
+      /* compatibility consonant: JongSeong of a typed syllable if possible,
+         moved to next syllable later if a vowel follows */
+      c = compat_consonant[uc - 0x3131][0];
+      j = compat_consonant[uc - 0x3131][1];
+      if (h.keyed && h.cho >= 0 && h.jung >= 0 && h.jong == 0 && j) {
+        h.jong = j;
+      }
+      else if (h.keyed && h.cho >= 0 && h.jung >= 0 && h.jong && compose_jong(h.jong, j)) {
+        h.jong = compose_jong(h.jong, j);
+      }
+      else {
+        if (!compose_flush(&h)) break;
+        if (c >= 0) {
+          h.cho = c;
+          h.keyed = 1;
+        }
+        else if (!compose_put(&h, uc))
+          break;
+      }
+    }
+    else if (uc >= 0x314f && uc <= 0x3163) {
+      /* compatibility vowel */
+      j = uc - 0x314f;
+      if (h.keyed && h.cho >= 0 && h.jung >= 0 && h.jong) {
+        /* move (last part of) JongSeong to ChoSeong of next syllable */
+        int i, jong = h.jong, rest = 0;
+        for (i = 0; i < 11; i++)
+          if (compound_jong[i][2] == jong) {
+            rest = compound_jong[i][0];
+            jong = compound_jong[i][1];
+          }
+        h.jong = rest;
+        if (!compose_flush(&h)) break;
+        h.cho = jong_to_cho[jong];
+        h.jung = j;
+        h.keyed = 1;
+      }
+      else if (h.keyed && h.cho >= 0 && h.jung < 0) {
+        h.jung = j;
+      }
+      else if (h.keyed && h.jung >= 0 && h.jong == 0 && compose_jung(h.jung, j) >= 0) {
+        h.jung = compose_jung(h.jung, j);
+      }
+      else {
+        if (!compose_flush(&h)) break;
+        h.jung = j;
+        h.keyed = 1;
+      }
+    }
+    else if (uc >= 44032 && uc <= 55195) {
+      /* johap syllable; may get conjoining JongSeong */
+      if (!compose_flush(&h)) break;
+      uc -= 44032;
+      h.cho = uc / 588;
+      h.jung = uc % 588 / 28;
+      h.jong = uc % 28;
+    }
+    else {
+      /* other chars are copied as is */
+      if (!compose_flush(&h) || h.p + n > h.p_limit) break;
+      memmove(h.p, s, n);
+      h.p += n;
+    }
+  }
+  compose_flush(&h);
+
+  *h.p = '\0';
+  return h.p - out_buf;
+}
+
+int
+utf32_jamo_to_ncode(int utf32)
+  /* returns ncode of standalone jamo, or 0 if utf32 is not a jamo */
+{
+  int uc = utf32;
+  if (uc >= 0x1100 && uc <= 0x1112)
+    return uc - 0x1100 + 0xa2;
+  if (uc >= 0x1161 && uc <= 0x1175)
+    return uc - 0x1161 + 0xb6;
+  if (uc >= 0x11a8 && uc <= 0x11c2)
+    return uc - 0x11a8 + 0xcb;
+  if (uc >= 0x3131 && uc <= 0x314e)
+    return (compat_consonant[uc - 0x3131][0] >= 0)?
+           compat_consonant[uc - 0x3131][0] + 0xa2 :
+           compat_consonant[uc - 0x3131][1] - 1 + 0xcb;
+  if (uc >= 0x314f && uc <= 0x3163)
+    return uc - 0x314f + 0xb6;
+  return 0;
+}
@@ -69,13 +69,28 @@ extern "C" {
 /* Unicode Hangul Jamo code: 0x1100~0x11ff */
 /* See: https://en.wikipedia.org/wiki/Hangul_Jamo_(Unicode_block) */
 
+/* Unicode Hangul Compatibility Jamo code: 0x3131~0x318e */
+/* consonants 0x3131~0x314e and vowels 0x314f~0x3163 are in use */
+
 
 int utf8_to_utf32(const unsigned char *utf8_str, int *utf32_ret);
   /* returns number of utf8 chars consumes */
 
+int utf32_to_utf8(int utf32, unsigned char *utf8_buf);
+  /* returns number of utf8 chars written (1~4); utf8_buf is not terminated */
+
 int utf8_to_ncode(const unsigned char *utf8_str, unsigned char *n_buf, int n_buf_size);
   /* returns strlen of n_buf */
 
+int utf8_compose_hangul(const unsigned char *utf8_str, unsigned char *out_buf, int out_buf_size);
+  /* compose hangul jamo sequences into johap syllables (NFC-style);
+     conjoining jamo (0x1100~0x11ff) and compatibility jamo (0x3131~0x318e)
+     as typed on phones; out_buf may be utf8_str for in-place composing;
+     returns strlen of out_buf */
+
+int utf32_jamo_to_ncode(int utf32);
+  /* returns ncode of standalone jamo, or 0 if utf32 is not a jamo */
+
 
 #ifdef __cplusplus
 }